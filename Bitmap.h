@@ -0,0 +1,172 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#ifdef _WIN32
+// GDI's min/max macros would break std::min and std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+using namespace std;
+
+// Encode a top-down 32-bit BGRA pixel buffer as an uncompressed .bmp file image
+inline vector<unsigned char> EncodeBMP(int width, int height, const unsigned char *bgra)
+{
+    const uint32_t header_size = 14 + 40;
+    const uint32_t pixel_bytes = static_cast<uint32_t>(width) * static_cast<uint32_t>(height) * 4;
+    vector<unsigned char> image(header_size + pixel_bytes, 0);
+
+    auto put16 = [&image](size_t offset, uint16_t value)
+    {
+        image[offset] = value & 0xFF;
+        image[offset + 1] = (value >> 8) & 0xFF;
+    };
+    auto put32 = [&image](size_t offset, uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+            image[offset + i] = (value >> (8 * i)) & 0xFF;
+    };
+
+    // BITMAPFILEHEADER
+    image[0] = 'B';
+    image[1] = 'M';
+    put32(2, header_size + pixel_bytes);
+    put32(10, header_size);
+
+    // BITMAPINFOHEADER, negative height marks the rows as top-down
+    put32(14, 40);
+    put32(18, static_cast<uint32_t>(width));
+    put32(22, static_cast<uint32_t>(-height));
+    put16(26, 1);
+    put16(28, 32);
+    put32(34, pixel_bytes);
+
+    memcpy(image.data() + header_size, bgra, pixel_bytes);
+    return image;
+}
+
+// Non-owning view of 32-bit BGRA pixels, e.g. a FrameBuffer or the bits of a DIB section
+struct PixelSurface
+{
+    uint32_t *pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int stride = 0; // in pixels
+};
+
+// A 32-bit BGRA pixel buffer, stored top-down with no row padding
+struct FrameBuffer
+{
+    int width = 0;
+    int height = 0;
+    vector<uint32_t> pixels;
+
+    void Resize(int new_width, int new_height)
+    {
+        width = new_width;
+        height = new_height;
+        pixels.resize(static_cast<size_t>(width) * height);
+    }
+    void Clear(uint32_t bgra = 0xFFFFFFFF)
+    {
+        std::fill(pixels.begin(), pixels.end(), bgra);
+    }
+    PixelSurface Surface()
+    {
+        PixelSurface surface;
+        surface.pixels = pixels.data();
+        surface.width = width;
+        surface.height = height;
+        surface.stride = width;
+        return surface;
+    }
+    vector<unsigned char> EncodeBMP() const
+    {
+        return ::EncodeBMP(width, height, reinterpret_cast<const unsigned char *>(pixels.data()));
+    }
+};
+
+#ifdef _WIN32
+inline BITMAPINFO FrameBufferInfo(int width, int height)
+{
+    BITMAPINFO bmi = {};
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    return bmi;
+}
+
+// Run a GDI draw callback against an offscreen white canvas and copy the result into target.
+// Each call uses its own memory DC, so it is safe to call from a worker thread.
+template <typename DrawFn>
+bool RenderGDIToFrameBuffer(FrameBuffer &target, int width, int height, DrawFn draw)
+{
+    HDC screen = GetDC(NULL);
+    HDC hdc = CreateCompatibleDC(screen);
+    ReleaseDC(NULL, screen);
+
+    BITMAPINFO bmi = FrameBufferInfo(width, height);
+    void *bits = nullptr;
+    HBITMAP hBitmap = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+    if (hBitmap == NULL)
+    {
+        DeleteDC(hdc);
+        return false;
+    }
+    HBITMAP hOldBitmap = (HBITMAP)SelectObject(hdc, hBitmap);
+    PatBlt(hdc, 0, 0, width, height, WHITENESS);
+
+    draw(hdc);
+
+    // Make sure GDI has finished writing into the DIB before reading it
+    GdiFlush();
+    target.Resize(width, height);
+    memcpy(target.pixels.data(), bits, target.pixels.size() * sizeof(uint32_t));
+
+    SelectObject(hdc, hOldBitmap);
+    DeleteObject(hBitmap);
+    DeleteDC(hdc);
+    return true;
+}
+
+// Run a GDI draw callback against an offscreen white canvas and return it encoded as .bmp
+template <typename DrawFn>
+vector<unsigned char> RenderGDIToBMP(int width, int height, DrawFn draw)
+{
+    FrameBuffer frame;
+    if (!RenderGDIToFrameBuffer(frame, width, height, draw))
+        return vector<unsigned char>();
+    return frame.EncodeBMP();
+}
+
+// Pixels of the top-down 32-bit DIB section selected into a memory DC;
+// empty if the DC is not backed by one
+inline PixelSurface SurfaceFromDC(HDC hdc)
+{
+    PixelSurface surface;
+    DIBSECTION dib = {};
+    HBITMAP hBitmap = (HBITMAP)GetCurrentObject(hdc, OBJ_BITMAP);
+    if (hBitmap == NULL || GetObject(hBitmap, sizeof(dib), &dib) != sizeof(dib))
+        return surface;
+    if (dib.dsBm.bmBitsPixel != 32 || dib.dsBmih.biHeight > 0)
+        return surface;
+    surface.pixels = static_cast<uint32_t *>(dib.dsBm.bmBits);
+    surface.width = dib.dsBm.bmWidth;
+    surface.height = dib.dsBm.bmHeight;
+    surface.stride = dib.dsBm.bmWidthBytes / 4;
+    return surface;
+}
+
+// Copy a frame buffer to a window DC in a single blit
+inline void PresentFrameBuffer(HDC hdc, const FrameBuffer &frame)
+{
+    BITMAPINFO bmi = FrameBufferInfo(frame.width, frame.height);
+    SetDIBitsToDevice(hdc, 0, 0, frame.width, frame.height, 0, 0, 0, frame.height, frame.pixels.data(), &bmi, DIB_RGB_COLORS);
+}
+#endif
@@ -0,0 +1,247 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "XYPlot.h"
+using namespace std;
+
+// A subplot's region of the figure canvas in pixels, right and bottom exclusive
+struct PanelRect
+{
+    int left;
+    int top;
+    int right;
+    int bottom;
+};
+
+// A rows x columns grid of XYPlot subplots drawn into one canvas.
+//
+// Panels render in parallel into disjoint regions of a single frame buffer.
+// Subplots with linked axes take their limits and ticks from one SharedAxes
+// computed per render, and all subplots share the label fonts and one set of
+// scratch buffers per worker thread rather than one per subplot.
+class Figure
+{
+private:
+    int rows;
+    int columns;
+    int width;
+    int height;
+    vector<unique_ptr<XYPlot>> subplots; // row-major
+    SharedAxes shared_axes;
+    vector<RenderScratch> worker_scratch;
+    int thread_count;
+    RenderCache *render_cache;
+#ifdef _WIN32
+    shared_ptr<PlotFonts> fonts;
+#endif
+
+    // Integer division spreads the leftover pixels across the grid
+    int PanelLeft(int column) const
+    {
+        return column * width / columns;
+    }
+    int PanelTop(int row) const
+    {
+        return row * height / rows;
+    }
+
+    // Lay out the panels and compute the linked limits and ticks once for all subplots
+    void PrepareSubplots()
+    {
+        for (int i = 0; i < static_cast<int>(subplots.size()); i++)
+        {
+            PanelRect rect = Panel(i / columns, i % columns);
+            subplots[i]->SetCanvasSize(rect.right - rect.left, rect.bottom - rect.top);
+        }
+        if (!shared_axes.link_x && !shared_axes.link_y)
+            return;
+
+        AxisLimits limits = {numeric_limits<double>::infinity(), -numeric_limits<double>::infinity(),
+                             numeric_limits<double>::infinity(), -numeric_limits<double>::infinity()};
+        XYPlot *densest_x = nullptr;
+        XYPlot *densest_y = nullptr;
+        for (const unique_ptr<XYPlot> &plot : subplots)
+        {
+            if (plot->SeriesCount() == 0)
+                continue;
+            AxisLimits bounds = plot->ComputeLimits();
+            limits.x_lower = std::min(limits.x_lower, bounds.x_lower);
+            limits.x_upper = std::max(limits.x_upper, bounds.x_upper);
+            limits.y_lower = std::min(limits.y_lower, bounds.y_lower);
+            limits.y_upper = std::max(limits.y_upper, bounds.y_upper);
+            // The tick heuristic follows the number of distinct values, so use the densest subplot
+            if (densest_x == nullptr || plot->UniqueXCount() > densest_x->UniqueXCount())
+                densest_x = plot.get();
+            if (densest_y == nullptr || plot->UniqueYCount() > densest_y->UniqueYCount())
+                densest_y = plot.get();
+        }
+        if (densest_x == nullptr)
+            return;
+        shared_axes.limits = limits;
+        vector<double> unused;
+        shared_axes.x_ticks.clear();
+        shared_axes.y_ticks.clear();
+        if (shared_axes.link_x)
+            densest_x->ComputeTicks(limits, shared_axes.x_ticks, unused);
+        if (shared_axes.link_y)
+            densest_y->ComputeTicks(limits, unused, shared_axes.y_ticks);
+    }
+
+public:
+    Figure(int grid_rows, int grid_columns, int canvas_width = 800, int canvas_height = 600)
+    {
+        rows = std::max(grid_rows, 1);
+        columns = std::max(grid_columns, 1);
+        width = canvas_width;
+        height = canvas_height;
+        thread_count = std::max(1u, thread::hardware_concurrency());
+        render_cache = nullptr;
+#ifdef _WIN32
+        fonts = make_shared<PlotFonts>();
+#endif
+        for (int i = 0; i < rows * columns; i++)
+        {
+            subplots.push_back(make_unique<XYPlot>());
+            subplots.back()->SetSharedAxes(&shared_axes);
+#ifdef _WIN32
+            subplots.back()->SetFonts(fonts);
+#endif
+        }
+        PrepareSubplots();
+    }
+    // Subplots point back into the figure, so it cannot be copied
+    Figure(const Figure &) = delete;
+    Figure &operator=(const Figure &) = delete;
+
+    XYPlot &Subplot(int row, int column)
+    {
+        return *subplots[row * columns + column];
+    }
+    int Rows() const
+    {
+        return rows;
+    }
+    int Columns() const
+    {
+        return columns;
+    }
+    int Width() const
+    {
+        return width;
+    }
+    int Height() const
+    {
+        return height;
+    }
+    PanelRect Panel(int row, int column) const
+    {
+        return {PanelLeft(column), PanelTop(row), PanelLeft(column + 1), PanelTop(row + 1)};
+    }
+
+    // Linked axes show the same data window and ticks in every subplot
+    void LinkXAxes(bool linked = true)
+    {
+        shared_axes.link_x = linked;
+    }
+    void LinkYAxes(bool linked = true)
+    {
+        shared_axes.link_y = linked;
+    }
+    void SetPalette(Palette palette)
+    {
+        for (unique_ptr<XYPlot> &plot : subplots)
+        {
+            plot->SetPalette(palette);
+        }
+    }
+    // Worker threads used by Render; panels are handed out one at a time
+    void SetThreads(int count)
+    {
+        thread_count = std::max(count, 1);
+    }
+    void SetRenderCache(RenderCache *cache)
+    {
+        render_cache = cache;
+    }
+
+    uint64_t RenderKey()
+    {
+        PrepareSubplots();
+        ContentHasher hasher;
+        hasher.AddString("Figure");
+        hasher.AddInt(rows);
+        hasher.AddInt(columns);
+        hasher.AddInt(width);
+        hasher.AddInt(height);
+        for (unique_ptr<XYPlot> &plot : subplots)
+        {
+            hasher.AddInt(plot->SeriesCount() == 0 ? 0 : plot->RenderKey());
+        }
+        return hasher.Digest();
+    }
+
+    // Draw every subplot into its panel of target, in parallel
+    void Render(FrameBuffer &target)
+    {
+        target.Resize(width, height);
+        target.Clear();
+        PrepareSubplots();
+
+        int panels = static_cast<int>(subplots.size());
+        int workers = std::min(thread_count, panels);
+        if (worker_scratch.size() < static_cast<size_t>(workers))
+            worker_scratch.resize(workers);
+
+        atomic<int> next_panel(0);
+        auto work = [this, &target, &next_panel, panels](int worker)
+        {
+            for (int i = next_panel.fetch_add(1); i < panels; i = next_panel.fetch_add(1))
+            {
+                XYPlot &plot = *subplots[i];
+                if (plot.SeriesCount() == 0)
+                    continue;
+                PanelRect rect = Panel(i / columns, i % columns);
+                PixelSurface panel;
+                panel.pixels = target.pixels.data() + static_cast<size_t>(rect.top) * target.width + rect.left;
+                panel.width = plot.CanvasWidth();
+                panel.height = plot.CanvasHeight();
+                panel.stride = target.width;
+                plot.SetScratch(&worker_scratch[worker]);
+                plot.RenderPanel(panel);
+                plot.SetScratch(nullptr);
+            }
+        };
+        vector<thread> threads;
+        for (int worker = 1; worker < workers; worker++)
+        {
+            threads.emplace_back(work, worker);
+        }
+        work(0);
+        for (thread &t : threads)
+        {
+            t.join();
+        }
+    }
+
+    // Render the figure and return it as a .bmp image, through the render cache if one is set
+    vector<unsigned char> RenderImage()
+    {
+        vector<unsigned char> image;
+        uint64_t key = 0;
+        if (render_cache != nullptr)
+        {
+            key = RenderKey();
+            if (render_cache->Lookup(key, image))
+                return image;
+        }
+        FrameBuffer frame;
+        Render(frame);
+        image = frame.EncodeBMP();
+        if (render_cache != nullptr)
+            render_cache->Store(key, image);
+        return image;
+    }
+};
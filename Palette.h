@@ -0,0 +1,176 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+struct RGBColor
+{
+    int r;
+    int g;
+    int b;
+};
+
+// Built-in categorical palettes, usable at compile time
+constexpr RGBColor Tableau10Colors[] = {
+    {31, 119, 180}, {255, 127, 14}, {44, 160, 44}, {214, 39, 40}, {148, 103, 189},
+    {140, 86, 75}, {227, 119, 194}, {127, 127, 127}, {188, 189, 34}, {23, 190, 207}};
+constexpr RGBColor OkabeItoColors[] = {
+    {230, 159, 0}, {86, 180, 233}, {0, 158, 115}, {240, 228, 66},
+    {0, 114, 178}, {213, 94, 0}, {204, 121, 167}, {0, 0, 0}};
+constexpr RGBColor Set2Colors[] = {
+    {102, 194, 165}, {252, 141, 98}, {141, 160, 203}, {231, 138, 195},
+    {166, 216, 84}, {255, 217, 47}, {229, 196, 148}, {179, 179, 179}};
+
+constexpr double GoldenRatioConjugate = 0.618033988749894848;
+
+enum class PaletteKind
+{
+    Tableau10,
+    OkabeIto,
+    Set2,
+    GoldenHSV,
+    OKLab,
+    Custom
+};
+
+class Palette
+{
+private:
+    PaletteKind kind;
+    vector<RGBColor> custom_colors;
+
+    static int ToByte(double value)
+    {
+        // Round a 0..1 channel to 0..255, clamping anything out of gamut
+        return static_cast<int>(std::lround(std::min(1.0, std::max(0.0, value)) * 255.0));
+    }
+
+    static RGBColor HSVToRGB(double h, double s, double v)
+    {
+        double hh = (h - std::floor(h)) * 6.0;
+        int sector = static_cast<int>(hh) % 6;
+        double f = hh - std::floor(hh);
+        double p = v * (1.0 - s);
+        double q = v * (1.0 - s * f);
+        double t = v * (1.0 - s * (1.0 - f));
+        switch (sector)
+        {
+        case 0:
+            return {ToByte(v), ToByte(t), ToByte(p)};
+        case 1:
+            return {ToByte(q), ToByte(v), ToByte(p)};
+        case 2:
+            return {ToByte(p), ToByte(v), ToByte(t)};
+        case 3:
+            return {ToByte(p), ToByte(q), ToByte(v)};
+        case 4:
+            return {ToByte(t), ToByte(p), ToByte(v)};
+        default:
+            return {ToByte(v), ToByte(p), ToByte(q)};
+        }
+    }
+
+    static double LinearToSRGB(double c)
+    {
+        if (c <= 0.0031308)
+            return 12.92 * c;
+        return 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+    }
+
+    static RGBColor OKLabToRGB(double L, double a, double b)
+    {
+        // OKLab -> LMS (cube roots)
+        double l_ = L + 0.3963377774 * a + 0.2158037573 * b;
+        double m_ = L - 0.1055613458 * a - 0.0638541728 * b;
+        double s_ = L - 0.0894841775 * a - 1.2914855480 * b;
+        double l = l_ * l_ * l_;
+        double m = m_ * m_ * m_;
+        double s = s_ * s_ * s_;
+
+        // LMS -> linear sRGB
+        double r = 4.0767416621 * l - 3.3077115913 * m + 0.2309699292 * s;
+        double g = -1.2684380046 * l + 2.6097574011 * m - 0.3413193965 * s;
+        double bl = -0.0041960863 * l - 0.7034186147 * m + 1.7076147010 * s;
+        return {ToByte(LinearToSRGB(r)), ToByte(LinearToSRGB(g)), ToByte(LinearToSRGB(bl))};
+    }
+
+    static RGBColor GoldenHSVColor(int i)
+    {
+        // Step the hue by the golden ratio so consecutive colors are far apart,
+        // and vary saturation/value in bands so large n stays distinguishable
+        double h = 0.1 + i * GoldenRatioConjugate;
+        double s = 0.55 + 0.15 * (i % 3);
+        double v = 0.95 - 0.15 * ((i / 3) % 3);
+        return HSVToRGB(h, s, v);
+    }
+
+    static RGBColor OKLabColor(int i)
+    {
+        // Constant lightness and chroma in a perceptually uniform space,
+        // hue stepped by the golden ratio
+        const double TwoPi = 6.28318530717958647692;
+        double hue = TwoPi * (0.1 + i * GoldenRatioConjugate);
+        double L = 0.72 - 0.08 * ((i / 4) % 3);
+        double C = 0.12;
+        return OKLabToRGB(L, C * std::cos(hue), C * std::sin(hue));
+    }
+
+    static RGBColor FromTable(const RGBColor *table, int size, int i)
+    {
+        // Once a fixed palette runs out, continue with the golden-ratio sequence
+        if (i < size)
+            return table[i];
+        return GoldenHSVColor(i - size);
+    }
+
+public:
+    explicit Palette(PaletteKind palette_kind = PaletteKind::Tableau10)
+    {
+        kind = palette_kind;
+    }
+    explicit Palette(vector<RGBColor> colors)
+    {
+        kind = PaletteKind::Custom;
+        custom_colors = colors;
+    }
+    PaletteKind Kind() const
+    {
+        return kind;
+    }
+    const vector<RGBColor> &CustomColors() const
+    {
+        return custom_colors;
+    }
+
+    // Color of the i-th series. Depends only on the palette and i, so it is
+    // O(1), stable across runs, and a prefix of Generate(n) for any n > i.
+    RGBColor ColorAt(int i) const
+    {
+        switch (kind)
+        {
+        case PaletteKind::Tableau10:
+            return FromTable(Tableau10Colors, 10, i);
+        case PaletteKind::OkabeIto:
+            return FromTable(OkabeItoColors, 8, i);
+        case PaletteKind::Set2:
+            return FromTable(Set2Colors, 8, i);
+        case PaletteKind::GoldenHSV:
+            return GoldenHSVColor(i);
+        case PaletteKind::OKLab:
+            return OKLabColor(i);
+        default:
+            return FromTable(custom_colors.data(), static_cast<int>(custom_colors.size()), i);
+        }
+    }
+
+    vector<RGBColor> Generate(int n) const
+    {
+        vector<RGBColor> colors;
+        colors.reserve(n);
+        for (int i = 0; i < n; i++)
+        {
+            colors.push_back(ColorAt(i));
+        }
+        return colors;
+    }
+};
@@ -1,16 +1,17 @@
+#pragma once
 #include <vector>
 #include <string>
+// GDI's min/max macros would break std::min and std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
-#include <random>
 #include <stdlib.h>
 #include <cstdlib>
+#include "Palette.h"
+#include "RenderCache.h"
+#include "Bitmap.h"
 using namespace std;
-struct RGB
-{
-    unsigned char red;
-    unsigned char green;
-    unsigned char blue;
-};
 struct Sector
 {
     double value;           // Value or proportion of the sector
@@ -21,58 +22,26 @@ class PieChart
 {
     vector<Sector> sectors;
     int numPoints;
-    std::vector<RGB> GenerateRandomColors(int numColors)
-    {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dis(0, 255);
-
-        std::vector<RGB> colors(numColors);
-
-        for (int i = 0; i < numColors; ++i)
-        {
-            RGB color;
-            color.red = static_cast<unsigned char>(dis(gen));
-            color.green = static_cast<unsigned char>(dis(gen));
-            color.blue = static_cast<unsigned char>(dis(gen));
-
-            // Check if the generated color already exists
-            bool duplicateColor = false;
-            for (int j = 0; j < i; ++j)
-            {
-                if (colors[j].red == color.red && colors[j].green == color.green && colors[j].blue == color.blue)
-                {
-                    duplicateColor = true;
-                    break;
-                }
-            }
-
-            if (duplicateColor)
-            {
-                --i; // Retry generating a color
-            }
-            else
-            {
-                colors[i] = color;
-            }
-        }
-
-        return colors;
-    }
+    Palette palette;
+    RenderCache *render_cache = nullptr;
 
+    // Bump whenever the drawing code changes so stale cached images are never reused
+    static constexpr int RenderVersion = 1;
+    static constexpr int CanvasWidth = 800;
+    static constexpr int CanvasHeight = 600;
     std::vector<Sector> CreateSectors(const std::vector<double> &values, const std::vector<std::string> &identifiers)
     {
         std::vector<Sector> sectors;
 
-        // Generate random colors for the sectors
-        std::vector<RGB> colors = GenerateRandomColors(values.size());
+        // Colors come from the palette, so the same input always gives the same chart
+        std::vector<RGBColor> colors = palette.Generate(values.size());
 
         // Create the sectors
         for (size_t i = 0; i < values.size(); ++i)
         {
             Sector sector;
             sector.value = values[i];
-            sector.color = RGB(colors[i].red, colors[i].green, colors[i].blue);
+            sector.color = RGB(colors[i].r, colors[i].g, colors[i].b);
             sector.identifier = identifiers[i];
             sectors.push_back(sector);
         }
@@ -81,6 +50,14 @@ class PieChart
     }
 
 public:
+    void SetPalette(Palette chart_palette)
+    {
+        palette = chart_palette;
+    }
+    void SetRenderCache(RenderCache *cache)
+    {
+        render_cache = cache;
+    }
     void InitialisePieChart(vector<double> proportions, vector<string> identifiers = {})
     {
         if (identifiers.size() == 0)
@@ -97,6 +74,59 @@ public:
         CreatePieChartWindow(sectors, centerX, centerY, radius);
     }
 
+    // Hash of everything that affects the rendered image: geometry, values, labels and colors
+    uint64_t RenderKey(const std::vector<Sector> &sectors, int centerX, int centerY, int radius)
+    {
+        ContentHasher hasher;
+        hasher.AddString("PieChart");
+        hasher.AddInt(RenderVersion);
+        hasher.AddInt(CanvasWidth);
+        hasher.AddInt(CanvasHeight);
+        hasher.AddInt(centerX);
+        hasher.AddInt(centerY);
+        hasher.AddInt(radius);
+        hasher.AddInt(sectors.size());
+        for (const Sector &sector : sectors)
+        {
+            hasher.AddDouble(sector.value);
+            hasher.AddInt(sector.color);
+            hasher.AddString(sector.identifier);
+        }
+        return hasher.Digest();
+    }
+
+    // Render the chart offscreen and return it as a .bmp image. With a render
+    // cache attached, an unchanged chart is returned without drawing anything.
+    vector<unsigned char> RenderImage(vector<double> proportions, vector<string> identifiers = {})
+    {
+        if (identifiers.size() == 0)
+        {
+            vector<string> temp(proportions.size(), "");
+            identifiers = temp;
+        }
+        numPoints = proportions.size();
+        sectors = CreateSectors(proportions, identifiers);
+        int centerX = 400;
+        int centerY = 300;
+        int radius = 200;
+
+        vector<unsigned char> image;
+        uint64_t key = 0;
+        if (render_cache != nullptr)
+        {
+            key = RenderKey(sectors, centerX, centerY, radius);
+            if (render_cache->Lookup(key, image))
+                return image;
+        }
+        image = RenderGDIToBMP(CanvasWidth, CanvasHeight, [&](HDC hdc)
+                               {
+                                   DrawPieChart(hdc, sectors, centerX, centerY, radius);
+                                   DrawLegend(hdc, sectors, centerX + radius + 20, centerY + radius - 20); });
+        if (render_cache != nullptr && !image.empty())
+            render_cache->Store(key, image);
+        return image;
+    }
+
     void CreatePieChartWindow(const std::vector<Sector> &sectors, int centerX, int centerY, int radius)
     {
         // Register the window class
@@ -115,7 +145,7 @@ public:
             CLASS_NAME,
             "Pie Chart Window",
             WS_OVERLAPPEDWINDOW,
-            CW_USEDEFAULT, CW_USEDEFAULT, 800, 600,
+            CW_USEDEFAULT, CW_USEDEFAULT, CanvasWidth, CanvasHeight,
             NULL,
             NULL,
             GetModuleHandle(NULL),
@@ -166,11 +196,6 @@ public:
             totalValue += sector.value;
         }
 
-        // Generate random colors for the sectors
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dis(0, 255);
-
         // Draw the sectors of the pie chart
         double startAngle = 0.0;
         for (const Sector &sector : sectors)
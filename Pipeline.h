@@ -0,0 +1,500 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include "SeriesStore.h"
+#include "Viewport.h"
+#include "Raster.h"
+#include "Reductions.h"
+using namespace std;
+
+// Render pipelines specialized at compile time on the series kind, the
+// element types of its columns and its marker style. Each instantiation is
+// one pass from raw column values to pixels, with transform, cull or
+// decimation, and drawing fused into a single loop. Options are resolved
+// with if constexpr, so the loops have no per-point switches or indirect
+// calls. SelectPipeline is the type-erased front end: it picks the
+// instantiation once per series from the runtime DTypes.
+
+enum class SeriesKind
+{
+    Line,    // polyline through the points in order
+    Scatter, // one marker per point
+    Band     // filled area between two y arrays, e.g. a derived series
+};
+
+// Screen mapping and drawing options shared by every point of a series
+struct PipelineParams
+{
+    double x_scale; // screen = value * scale + offset, the same mapping as TransformValues
+    double x_offset;
+    double y_scale;
+    double y_offset;
+    RGBColor color;
+    float line_width = 2.0f;
+    int marker_radius = 4;
+    uint8_t opacity = 255;                 // Band fills are translucent
+    const atomic<bool> *cancel = nullptr; // polled every PipelineChunk points during an interactive render
+};
+
+// Points processed between polls of the cancel flag, so one huge series can
+// be abandoned mid-frame without a check in every iteration
+constexpr size_t PipelineChunk = size_t(1) << 16;
+
+// Points tested together by the line and marker fast paths
+constexpr size_t DecimateBlock = 8;
+
+inline bool Cancelled(const PipelineParams &p)
+{
+    return p.cancel != nullptr && p.cancel->load(memory_order_relaxed);
+}
+
+inline PipelineParams MakePipelineParams(const AxisLimits &limits, const PlotArea &area, RGBColor color)
+{
+    PipelineParams p;
+    p.x_scale = (area.right - area.left) / (limits.x_upper - limits.x_lower);
+    p.x_offset = area.left - limits.x_lower * p.x_scale;
+    p.y_scale = (area.top - area.bottom) / (limits.y_upper - limits.y_lower);
+    p.y_offset = area.bottom - limits.y_lower * p.y_scale;
+    p.color = color;
+    return p;
+}
+
+struct PipelineCounts
+{
+    uint64_t drawn = 0;  // points left after culling and decimation
+    uint64_t culled = 0; // points with no visible pixels
+};
+
+#ifdef PLOT_RASTER_SSE2
+// Two consecutive column values as axis values
+inline __m128d LoadAxisPair(const double *v)
+{
+    return _mm_loadu_pd(v);
+}
+inline __m128d LoadAxisPair(const float *v)
+{
+    return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(v))));
+}
+inline __m128d LoadAxisPair(const int64_t *v)
+{
+    return _mm_set_pd(ToAxisValue(v[1]), ToAxisValue(v[0]));
+}
+#endif
+
+// True when all DecimateBlock points map into [left, right) on screen x and
+// have y * y_scale within [low, high]; false for any NaN
+template <typename X, typename Y>
+inline bool QuietBlock(const X *x, const Y *y, double x_scale, double x_offset, double y_scale, double left, double right, double low, double high)
+{
+#ifdef PLOT_RASTER_SSE2
+    const __m128d xs = _mm_set1_pd(x_scale), xo = _mm_set1_pd(x_offset), ys = _mm_set1_pd(y_scale);
+    const __m128d l = _mm_set1_pd(left), r = _mm_set1_pd(right), lo = _mm_set1_pd(low), hi = _mm_set1_pd(high);
+    __m128d ok = _mm_cmpeq_pd(xs, xs);
+    for (size_t j = 0; j < DecimateBlock; j += 2)
+    {
+        __m128d fx = _mm_add_pd(_mm_mul_pd(LoadAxisPair(x + j), xs), xo);
+        __m128d fy = _mm_mul_pd(LoadAxisPair(y + j), ys);
+        ok = _mm_and_pd(ok, _mm_and_pd(_mm_cmpge_pd(fx, l), _mm_cmplt_pd(fx, r)));
+        ok = _mm_and_pd(ok, _mm_and_pd(_mm_cmpge_pd(fy, lo), _mm_cmple_pd(fy, hi)));
+    }
+    return _mm_movemask_pd(ok) == 3;
+#else
+    bool quiet = true;
+    for (size_t j = 0; j < DecimateBlock; j++)
+    {
+        double fx = ToAxisValue(x[j]) * x_scale + x_offset;
+        double fy = ToAxisValue(y[j]) * y_scale;
+        quiet &= (fx >= left) & (fx < right) & (fy >= low) & (fy <= high);
+    }
+    return quiet;
+#endif
+}
+
+// Reduce a polyline to at most four vertices per pixel column: the first and
+// last point of each run of consecutive points in the column and its y
+// extremes, in their original order. With more points than pixels this keeps
+// the stroke's shape while the rasterizer sees O(width) segments. Runs left or
+// right of the clip collapse into one column each side; they are far enough
+// out that their strokes do not reach the visible edge; the points they drop
+// are counted as culled. A point with no finite screen position ends the run
+// and leaves a NaN vertex, which both rasterizers treat as a pen break, so the
+// line never bridges missing data. out_x and out_y must hold n values, the
+// worst case when every point falls in its own column. drawn is the vertex
+// count written, breaks included.
+template <typename X, typename Y>
+PipelineCounts DecimateLine(const X *x, const Y *y, size_t n, const PipelineParams &p, int clip_left, int clip_right, float *out_x, float *out_y)
+{
+    PipelineCounts counts;
+    const double x_scale = p.x_scale, y_scale = p.y_scale;
+    const double x_offset = p.x_offset - (clip_left - 4.0), y_offset = p.y_offset;
+    const double high = (clip_right + 4.0) - (clip_left - 4.0);
+    // Columns counted from the low collapsed one
+    auto column_of = [high](double fx)
+    { return static_cast<int>(fx > 0.0 ? (fx < high ? fx : high) : 0.0); };
+    const int high_column = column_of(high);
+
+    // Only indices and y are tracked per point; vertices are mapped again when emitted
+    size_t m = 0;
+    bool broken = true; // no vertex since the last break, so another is not needed
+    auto emit = [&](size_t i)
+    {
+        out_x[m] = static_cast<float>(ToAxisValue(x[i]) * x_scale + p.x_offset);
+        out_y[m] = static_cast<float>(ToAxisValue(y[i]) * y_scale + y_offset);
+        m++;
+        broken = false;
+    };
+    // Column -1 marks a point with no finite screen position, and -2 means no
+    // run is open, so both always take the slow path below
+    const int Gap = -1, NoRun = -2;
+    size_t first = 0, last = 0, low_index = 0, high_index = 0;
+    double low_y = 0.0, high_y = 0.0;
+    int column = NoRun;
+    auto flush = [&]()
+    {
+        size_t emitted = m;
+        size_t a = std::min(low_index, high_index);
+        size_t b = std::max(low_index, high_index);
+        emit(first);
+        if (a != first)
+            emit(a);
+        if (b != a)
+            emit(b);
+        if (last != b)
+            emit(last);
+        if (column == 0 || column == high_column)
+            counts.culled += (last - first + 1) - (m - emitted);
+    };
+
+    // Screen x bounds of the open run's column; the outer columns are open-ended
+    double run_left = 0.0, run_right = 0.0;
+    for (size_t start = 0; start < n; start += PipelineChunk)
+    {
+        if (Cancelled(p))
+        {
+            counts.drawn = m;
+            return counts;
+        }
+        size_t end = std::min(n, start + PipelineChunk);
+        size_t i = start;
+        while (i < end)
+        {
+            size_t block_end = std::min(end, i + DecimateBlock);
+            // A block that stays in the open column without a new extreme leaves
+            // the run as it is. The test is branch-free and fails on NaN, so any
+            // other block is handled point by point
+            if (column >= 0 && block_end - i == DecimateBlock)
+            {
+                if (QuietBlock(x + i, y + i, x_scale, x_offset, y_scale, run_left, run_right, low_y, high_y))
+                {
+                    i = block_end;
+                    continue;
+                }
+            }
+            for (; i < block_end; i++)
+            {
+                double fx = ToAxisValue(x[i]) * x_scale + x_offset;
+                double fy = ToAxisValue(y[i]) * y_scale; // offset does not change the order
+                // x - x is NaN exactly when x is NaN or infinite
+                bool finite = (fx - fx) + (fy - fy) == 0.0;
+                int c = finite ? column_of(fx) : Gap;
+                if (c != column)
+                {
+                    if (column != NoRun)
+                    {
+                        last = i - 1;
+                        flush();
+                    }
+                    if (c == Gap)
+                    {
+                        counts.culled++;
+                        column = NoRun;
+                        if (!broken)
+                        {
+                            out_x[m] = out_y[m] = numeric_limits<float>::quiet_NaN();
+                            m++;
+                            broken = true;
+                        }
+                        continue;
+                    }
+                    column = c;
+                    run_left = c == 0 ? numeric_limits<double>::lowest() : c;
+                    run_right = c == high_column ? numeric_limits<double>::max() : c + 1.0;
+                    first = low_index = high_index = i;
+                    low_y = high_y = fy;
+                    continue;
+                }
+                if (fy < low_y)
+                {
+                    low_y = fy;
+                    low_index = i;
+                }
+                if (fy > high_y)
+                {
+                    high_y = fy;
+                    high_index = i;
+                }
+            }
+        }
+    }
+    if (column != NoRun)
+    {
+        last = n - 1;
+        flush();
+    }
+    counts.drawn = m;
+    return counts;
+}
+
+// True when all DecimateBlock points fall inside the width x height cells and
+// every cell they hit is already set in bits, whose rows are 1 << row_shift
+// cells apart; false for any NaN
+template <typename X, typename Y>
+inline bool CoveredBlock(const X *x, const Y *y, double x_scale, double x_offset, double y_scale, double y_offset, int width, int height, int row_shift, const uint64_t *bits)
+{
+    uint64_t covered = 1;
+#ifdef PLOT_RASTER_SSE2
+    const __m128d xs = _mm_set1_pd(x_scale), xo = _mm_set1_pd(x_offset);
+    const __m128d ys = _mm_set1_pd(y_scale), yo = _mm_set1_pd(y_offset);
+    const __m128d zero = _mm_setzero_pd(), w = _mm_set1_pd(width), h = _mm_set1_pd(height);
+    const __m128i shift = _mm_cvtsi32_si128(row_shift);
+    __m128d ok = _mm_cmpeq_pd(zero, zero);
+    __m128i cells[DecimateBlock / 2];
+    for (size_t j = 0; j < DecimateBlock; j += 2)
+    {
+        __m128d fx = _mm_add_pd(_mm_mul_pd(LoadAxisPair(x + j), xs), xo);
+        __m128d fy = _mm_add_pd(_mm_mul_pd(LoadAxisPair(y + j), ys), yo);
+        ok = _mm_and_pd(ok, _mm_and_pd(_mm_cmpge_pd(fx, zero), _mm_cmplt_pd(fx, w)));
+        ok = _mm_and_pd(ok, _mm_and_pd(_mm_cmpge_pd(fy, zero), _mm_cmplt_pd(fy, h)));
+        cells[j / 2] = _mm_or_si128(_mm_sll_epi32(_mm_cvttpd_epi32(fy), shift), _mm_cvttpd_epi32(fx));
+    }
+    if (_mm_movemask_pd(ok) != 3)
+        return false;
+    for (size_t j = 0; j < DecimateBlock / 2; j++)
+    {
+        uint32_t a = static_cast<uint32_t>(_mm_cvtsi128_si32(cells[j]));
+        uint32_t b = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_epi64(cells[j], 32)));
+        covered &= (bits[a >> 6] >> (a & 63)) & (bits[b >> 6] >> (b & 63));
+    }
+#else
+    for (size_t j = 0; j < DecimateBlock; j++)
+    {
+        double fx = ToAxisValue(x[j]) * x_scale + x_offset;
+        double fy = ToAxisValue(y[j]) * y_scale + y_offset;
+        if (!((fx >= 0.0) & (fx < width) & (fy >= 0.0) & (fy < height)))
+            return false;
+        size_t cell = (static_cast<size_t>(fy) << row_shift) | static_cast<size_t>(fx);
+        covered &= bits[cell >> 6] >> (cell & 63);
+    }
+#endif
+    return covered != 0;
+}
+
+// Call emit(px, py) once per pixel position that has a visible marker. The
+// position is floor() of the screen point; anchors outside
+// [left, right) x [top, bottom) are culled, and later points on an
+// already drawn position are skipped, since an identical marker is on top there.
+template <typename X, typename Y, typename Emit>
+PipelineCounts CullMarkers(const X *x, const Y *y, size_t n, const PipelineParams &p, int left, int top, int right, int bottom, AlignedVector<uint64_t> &occupancy, Emit emit)
+{
+    PipelineCounts counts;
+    if (right <= left || bottom <= top)
+    {
+        counts.culled = n;
+        return counts;
+    }
+    const int width = right - left;
+    const int height = bottom - top;
+    // Rows a power of two apart, so a cell index is a shift and an or
+    int row_shift = 0;
+    while ((size_t(1) << row_shift) < static_cast<size_t>(width))
+        row_shift++;
+    const size_t cell_count = static_cast<size_t>(height) << row_shift;
+    occupancy.assign((cell_count + 63) / 64, 0);
+    uint64_t *bits = occupancy.data();
+    // The block test keeps cell indices in 32 bits
+    const size_t block_limit = cell_count <= size_t(numeric_limits<int32_t>::max()) ? DecimateBlock : 0;
+    // Map straight to cells relative to (left, top); the range test uses & so
+    // it compiles to flag arithmetic rather than a chain of branches
+    const double x_scale = p.x_scale, x_offset = p.x_offset - left;
+    const double y_scale = p.y_scale, y_offset = p.y_offset - top;
+    const double cell_width = width, cell_height = height;
+    for (size_t start = 0; start < n; start += PipelineChunk)
+    {
+        if (Cancelled(p))
+            break;
+        size_t end = std::min(n, start + PipelineChunk);
+        size_t i = start;
+        while (i < end)
+        {
+            size_t block_end = std::min(end, i + DecimateBlock);
+            // Dense data mostly lands on positions already drawn; such a block
+            // changes nothing, so only the others go point by point
+            if (block_end - i == block_limit && CoveredBlock(x + i, y + i, x_scale, x_offset, y_scale, y_offset, width, height, row_shift, bits))
+            {
+                i = block_end;
+                continue;
+            }
+            for (; i < block_end; i++)
+            {
+                double fx = ToAxisValue(x[i]) * x_scale + x_offset;
+                double fy = ToAxisValue(y[i]) * y_scale + y_offset;
+                // False for NaN too
+                bool inside = (fx >= 0.0) & (fx < cell_width) & (fy >= 0.0) & (fy < cell_height);
+                if (!inside)
+                {
+                    counts.culled++;
+                    continue;
+                }
+                // Non-negative, so truncation is floor
+                int cx = static_cast<int>(fx);
+                int cy = static_cast<int>(fy);
+                size_t cell = (static_cast<size_t>(cy) << row_shift) + cx;
+                uint64_t flag = uint64_t(1) << (cell & 63);
+                uint64_t &word = bits[cell >> 6];
+                if (word & flag)
+                    continue;
+                word |= flag;
+                emit(left + cx, top + cy);
+                counts.drawn++;
+            }
+        }
+    }
+    return counts;
+}
+
+// The fused pipeline for one combination. Scatter and Line read x and y;
+// Band reads x, y (lower edge) and y_upper. Line and Band use scratch.screen_x
+// and screen_y (and band_lower, band_upper for Band), which must hold n values.
+template <SeriesKind Kind, MarkerStyle Marker, typename X, typename Y>
+PipelineCounts RunPipeline(const X *x, const Y *y, const Y *y_upper, size_t n, const PipelineParams &p, SoftwareRasterizer &raster, RenderScratch &scratch)
+{
+    PipelineCounts counts;
+    if constexpr (Kind == SeriesKind::Line)
+    {
+        // The whole polyline goes into one coverage mask so its joints blend once
+        float *sx = scratch.screen_x.data();
+        float *sy = scratch.screen_y.data();
+        counts = DecimateLine(x, y, n, p, raster.ClipLeft(), raster.ClipRight(), sx, sy);
+        size_t m = counts.drawn;
+        for (size_t start = 0; start + 1 < m; start += PipelineChunk)
+        {
+            if (Cancelled(p))
+                break;
+            size_t end = std::min(m - 1, start + PipelineChunk);
+            for (size_t i = start; i < end; i++)
+            {
+                raster.AddLine(sx[i], sy[i], sx[i + 1], sy[i + 1], p.line_width);
+            }
+        }
+        raster.FillMask(p.color, p.opacity);
+    }
+    else if constexpr (Kind == SeriesKind::Scatter)
+    {
+        const uint32_t packed = PackBGRA(p.color);
+        if constexpr (Marker == MarkerStyle::Point)
+        {
+            counts = CullMarkers(x, y, n, p, raster.ClipLeft(), raster.ClipTop(), raster.ClipRight(), raster.ClipBottom(), scratch.occupancy,
+                                 [&raster, packed](int px, int py)
+                                 { raster.PutPixel(px, py, packed); });
+        }
+        else
+        {
+            // A sprite anchored at px covers px - radius - 1 .. px + radius
+            const int r = p.marker_radius;
+            const SoftwareRasterizer::MarkerSprite &sprite = raster.Sprite(packed, r, Marker);
+            counts = CullMarkers(x, y, n, p, raster.ClipLeft() - r, raster.ClipTop() - r, raster.ClipRight() + r + 1, raster.ClipBottom() + r + 1, scratch.occupancy,
+                                 [&raster, &sprite, r](int px, int py)
+                                 { raster.StampSprite(sprite, px - r - 1, py - r - 1); });
+        }
+    }
+    else
+    {
+        float *sx = scratch.screen_x.data();
+        float *lower = scratch.band_lower.data();
+        float *upper = scratch.band_upper.data();
+        for (size_t i = 0; i < n; i++)
+        {
+            sx[i] = static_cast<float>(ToAxisValue(x[i]) * p.x_scale + p.x_offset);
+            lower[i] = static_cast<float>(ToAxisValue(y[i]) * p.y_scale + p.y_offset);
+            upper[i] = static_cast<float>(ToAxisValue(y_upper[i]) * p.y_scale + p.y_offset);
+        }
+        if (Cancelled(p))
+            return counts;
+        raster.AddBand(sx, lower, upper, n);
+        raster.FillMask(p.color, p.opacity);
+        counts.drawn = n;
+    }
+    return counts;
+}
+
+// Type-erased entry point for a series stored as two columns
+using SeriesPipeline = PipelineCounts (*)(const Column &x_column, const Column &y_column, const PipelineParams &p, SoftwareRasterizer &raster, RenderScratch &scratch);
+
+template <SeriesKind Kind, MarkerStyle Marker, typename X, typename Y>
+PipelineCounts RunColumns(const Column &x_column, const Column &y_column, const PipelineParams &p, SoftwareRasterizer &raster, RenderScratch &scratch)
+{
+    size_t n = std::min(x_column.Size(), y_column.Size());
+    return RunPipeline<Kind, Marker, X, Y>(x_column.Data<X>(), y_column.Data<Y>(), nullptr, n, p, raster, scratch);
+}
+
+// Element types follow the DType mapping of Column::Visit
+template <SeriesKind Kind, MarkerStyle Marker, typename X>
+SeriesPipeline SelectPipelineY(DType y)
+{
+    switch (y)
+    {
+    case DType::Float32:
+        return &RunColumns<Kind, Marker, X, float>;
+    case DType::Float64:
+        return &RunColumns<Kind, Marker, X, double>;
+    default:
+        return &RunColumns<Kind, Marker, X, int64_t>;
+    }
+}
+template <SeriesKind Kind, MarkerStyle Marker>
+SeriesPipeline SelectPipelineXY(DType x, DType y)
+{
+    switch (x)
+    {
+    case DType::Float32:
+        return SelectPipelineY<Kind, Marker, float>(y);
+    case DType::Float64:
+        return SelectPipelineY<Kind, Marker, double>(y);
+    default:
+        return SelectPipelineY<Kind, Marker, int64_t>(y);
+    }
+}
+
+// Pipeline for a Line or Scatter series; lines ignore the marker style.
+// Bands have three arrays and are drawn with RenderReduced instead.
+inline SeriesPipeline SelectPipeline(SeriesKind kind, MarkerStyle marker, DType x, DType y)
+{
+    if (kind != SeriesKind::Scatter)
+        return SelectPipelineXY<SeriesKind::Line, MarkerStyle::Circle>(x, y);
+    switch (marker)
+    {
+    case MarkerStyle::Square:
+        return SelectPipelineXY<SeriesKind::Scatter, MarkerStyle::Square>(x, y);
+    case MarkerStyle::Point:
+        return SelectPipelineXY<SeriesKind::Scatter, MarkerStyle::Point>(x, y);
+    default:
+        return SelectPipelineXY<SeriesKind::Scatter, MarkerStyle::Circle>(x, y);
+    }
+}
+
+// A derived series: its lower..upper band at the params' opacity, then the
+// center line opaque on top with center_width
+inline PipelineCounts RenderReduced(const ReducedSeries &r, PipelineParams p, float center_width, SoftwareRasterizer &raster, RenderScratch &scratch)
+{
+    size_t n = r.Size();
+    PipelineCounts band = RunPipeline<SeriesKind::Band, MarkerStyle::Circle, double, double>(r.x.data(), r.lower.data(), r.upper.data(), n, p, raster, scratch);
+    p.opacity = 255;
+    p.line_width = center_width;
+    PipelineCounts center = RunPipeline<SeriesKind::Line, MarkerStyle::Circle, double, double>(r.x.data(), r.center.data(), nullptr, n, p, raster, scratch);
+    band.drawn += center.drawn;
+    return band;
+}
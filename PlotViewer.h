@@ -0,0 +1,471 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "Viewport.h"
+#include "Bitmap.h"
+#ifdef _WIN32
+#include <windowsx.h>
+#endif
+using namespace std;
+
+// Platform-neutral input for the viewer. The Win32 window translates its
+// messages into these; headless runs feed them from a FakeEventSource.
+struct ViewEvent
+{
+    enum Kind
+    {
+        Paint,
+        Zoom,  // factor about (x, y)
+        Pan,   // drag by (x, y) pixels
+        Reset, // back to the initial view
+        Close
+    };
+    Kind kind;
+    double x = 0.0;
+    double y = 0.0;
+    double factor = 1.0;
+};
+
+class EventSource
+{
+public:
+    virtual ~EventSource() {}
+    // Fetch the next event, returning false once the source is exhausted
+    virtual bool Next(ViewEvent &event) = 0;
+};
+
+// Scripted event queue for driving the viewer without a window
+class FakeEventSource : public EventSource
+{
+private:
+    deque<ViewEvent> events;
+
+public:
+    void Push(ViewEvent event)
+    {
+        events.push_back(event);
+    }
+    void PushZoom(double factor, double x, double y)
+    {
+        ViewEvent event{ViewEvent::Zoom};
+        event.factor = factor;
+        event.x = x;
+        event.y = y;
+        Push(event);
+    }
+    void PushPan(double dx, double dy)
+    {
+        ViewEvent event{ViewEvent::Pan};
+        event.x = dx;
+        event.y = dy;
+        Push(event);
+    }
+    bool Next(ViewEvent &event) override
+    {
+        if (events.empty())
+            return false;
+        event = events.front();
+        events.pop_front();
+        return true;
+    }
+};
+
+// Interactive viewer core. A worker thread renders the requested view into a
+// back buffer and swaps it with the front buffer when done; painting only
+// blits the front buffer, so the UI thread never waits on rasterization.
+// View requests that arrive while a frame is rendering are coalesced into
+// one, and the in-flight frame is told to cancel.
+class PlotViewer
+{
+public:
+    // Render view into target. Should poll cancel and return false if it gave up early.
+    typedef function<bool(const AxisLimits &view, FrameBuffer &target, const atomic<bool> &cancel)> RenderFn;
+
+private:
+    int width;
+    int height;
+    AxisLimits initial_view;
+    RenderFn render;
+    function<void()> frame_ready;
+
+    // Request state, guarded by state_mutex
+    mutex state_mutex;
+    condition_variable state_changed;
+    AxisLimits requested_view;
+    uint64_t requested_generation = 0;
+    uint64_t started_generation = 0;
+    uint64_t completed_generation = 0;
+    bool rendering = false;
+    bool stopping = false;
+    atomic<bool> cancel{false};
+
+    // Front/back buffers; front_mutex is held only for a swap or a blit
+    mutex front_mutex;
+    FrameBuffer front;
+    FrameBuffer back;
+    bool has_frame = false;
+
+    thread worker;
+    atomic<uint64_t> frames_rendered{0};
+    atomic<uint64_t> frames_cancelled{0};
+    atomic<uint64_t> requests_coalesced{0};
+
+    // Mouse drag in progress, per viewer; touched only by the UI thread
+    bool dragging = false;
+    double drag_x = 0.0;
+    double drag_y = 0.0;
+
+    void WorkerLoop()
+    {
+        unique_lock<mutex> lock(state_mutex);
+        while (true)
+        {
+            state_changed.wait(lock, [this]
+                               { return stopping || requested_generation != started_generation; });
+            if (stopping)
+                break;
+
+            uint64_t generation = requested_generation;
+            AxisLimits view = requested_view;
+            started_generation = generation;
+            rendering = true;
+            cancel.store(false, memory_order_relaxed);
+            lock.unlock();
+
+            bool finished = render(view, back, cancel);
+            if (finished)
+            {
+                {
+                    lock_guard<mutex> front_lock(front_mutex);
+                    swap(front, back);
+                    has_frame = true;
+                }
+                frames_rendered++;
+                if (frame_ready)
+                    frame_ready();
+            }
+            else
+            {
+                frames_cancelled++;
+            }
+
+            lock.lock();
+            rendering = false;
+            if (finished)
+                completed_generation = generation;
+            state_changed.notify_all();
+        }
+    }
+
+    void Request(const AxisLimits &view)
+    {
+        lock_guard<mutex> lock(state_mutex);
+        // A request the worker has not picked up yet is simply replaced
+        if (requested_generation != started_generation)
+            requests_coalesced++;
+        if (rendering)
+            cancel.store(true, memory_order_relaxed);
+        requested_view = view;
+        requested_generation++;
+        state_changed.notify_all();
+    }
+
+public:
+    PlotViewer(int canvas_width, int canvas_height, AxisLimits view, RenderFn render_fn)
+    {
+        width = canvas_width;
+        height = canvas_height;
+        initial_view = view;
+        requested_view = view;
+        render = render_fn;
+    }
+    PlotViewer(const PlotViewer &) = delete;
+    PlotViewer &operator=(const PlotViewer &) = delete;
+    ~PlotViewer()
+    {
+        Stop();
+    }
+
+    // Called on the worker thread after each completed frame, e.g. to post a repaint
+    void SetFrameReadyCallback(function<void()> callback)
+    {
+        frame_ready = callback;
+    }
+
+    // Start the worker; a stopped viewer can be started again
+    void Start()
+    {
+        if (worker.joinable())
+            return;
+        {
+            lock_guard<mutex> lock(state_mutex);
+            stopping = false;
+        }
+        worker = thread(&PlotViewer::WorkerLoop, this);
+    }
+    void Stop()
+    {
+        {
+            lock_guard<mutex> lock(state_mutex);
+            stopping = true;
+            cancel.store(true, memory_order_relaxed);
+            state_changed.notify_all();
+        }
+        if (worker.joinable())
+            worker.join();
+    }
+
+    int Width() const
+    {
+        return width;
+    }
+    int Height() const
+    {
+        return height;
+    }
+    AxisLimits View()
+    {
+        lock_guard<mutex> lock(state_mutex);
+        return requested_view;
+    }
+
+    void RequestRender()
+    {
+        Request(View());
+    }
+    void RequestZoom(double factor, double screen_x, double screen_y)
+    {
+        Request(ZoomLimits(View(), PlotAreaFor(width, height), factor, screen_x, screen_y));
+    }
+    void RequestPan(double dx, double dy)
+    {
+        Request(PanLimits(View(), PlotAreaFor(width, height), dx, dy));
+    }
+    void RequestReset()
+    {
+        Request(initial_view);
+    }
+
+    // Hand the latest completed frame to blit. Returns false if nothing has been rendered yet.
+    template <typename BlitFn>
+    bool Present(BlitFn blit)
+    {
+        lock_guard<mutex> front_lock(front_mutex);
+        if (!has_frame)
+            return false;
+        blit(static_cast<const FrameBuffer &>(front));
+        return true;
+    }
+
+    // Apply one input event. Shared by the Win32 window and headless event sources.
+    // Returns false when the event asks the viewer to close.
+    template <typename BlitFn>
+    bool Dispatch(const ViewEvent &event, BlitFn blit)
+    {
+        switch (event.kind)
+        {
+        case ViewEvent::Paint:
+            Present(blit);
+            break;
+        case ViewEvent::Zoom:
+            RequestZoom(event.factor, event.x, event.y);
+            break;
+        case ViewEvent::Pan:
+            RequestPan(event.x, event.y);
+            break;
+        case ViewEvent::Reset:
+            RequestReset();
+            break;
+        case ViewEvent::Close:
+            return false;
+        }
+        return true;
+    }
+
+    // Drag tracking for the window showing this viewer. DragTo turns a mouse
+    // move into a Pan event, returning false when no drag is in progress.
+    void BeginDrag(double x, double y)
+    {
+        dragging = true;
+        drag_x = x;
+        drag_y = y;
+    }
+    bool DragTo(double x, double y, ViewEvent &event)
+    {
+        if (!dragging)
+            return false;
+        event.kind = ViewEvent::Pan;
+        event.x = x - drag_x;
+        event.y = y - drag_y;
+        drag_x = x;
+        drag_y = y;
+        return true;
+    }
+    void EndDrag()
+    {
+        dragging = false;
+    }
+
+    // Pump events until the source is exhausted or asks to close
+    template <typename BlitFn>
+    void Run(EventSource &source, BlitFn blit)
+    {
+        ViewEvent event;
+        while (source.Next(event))
+        {
+            if (!Dispatch(event, blit))
+                break;
+        }
+    }
+
+    // Block until the most recent request has been rendered, or the timeout expires
+    bool WaitForIdle(chrono::milliseconds timeout = chrono::milliseconds(5000))
+    {
+        unique_lock<mutex> lock(state_mutex);
+        return state_changed.wait_for(lock, timeout, [this]
+                                      { return stopping || (!rendering && completed_generation == requested_generation); });
+    }
+
+    uint64_t FramesRendered() const
+    {
+        return frames_rendered;
+    }
+    uint64_t FramesCancelled() const
+    {
+        return frames_cancelled;
+    }
+    uint64_t RequestsCoalesced() const
+    {
+        return requests_coalesced;
+    }
+};
+
+#ifdef _WIN32
+#define PLOT_VIEWER_FRAME_READY (WM_APP + 1)
+
+// Window procedure translating Win32 input into ViewEvents for the PlotViewer
+// stored in the window's user data
+inline LRESULT CALLBACK PlotViewerWndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    if (message == WM_NCCREATE)
+    {
+        CREATESTRUCTA *create = reinterpret_cast<CREATESTRUCTA *>(lParam);
+        SetWindowLongPtrA(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(create->lpCreateParams));
+        return DefWindowProcA(hwnd, message, wParam, lParam);
+    }
+    PlotViewer *viewer = reinterpret_cast<PlotViewer *>(GetWindowLongPtrA(hwnd, GWLP_USERDATA));
+    if (viewer == nullptr)
+        return DefWindowProcA(hwnd, message, wParam, lParam);
+
+    ViewEvent event{ViewEvent::Paint};
+    switch (message)
+    {
+    case WM_PAINT:
+    {
+        PAINTSTRUCT ps;
+        HDC hdc = BeginPaint(hwnd, &ps);
+        if (!viewer->Present([hdc](const FrameBuffer &frame)
+                             { PresentFrameBuffer(hdc, frame); }))
+        {
+            PatBlt(hdc, 0, 0, viewer->Width(), viewer->Height(), WHITENESS);
+        }
+        EndPaint(hwnd, &ps);
+        return 0;
+    }
+    case WM_ERASEBKGND:
+        // The blit covers the whole client area, erasing first would only flicker
+        return 1;
+    case PLOT_VIEWER_FRAME_READY:
+        InvalidateRect(hwnd, NULL, FALSE);
+        return 0;
+    case WM_MOUSEWHEEL:
+    {
+        POINT p = {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)};
+        ScreenToClient(hwnd, &p);
+        event.kind = ViewEvent::Zoom;
+        event.factor = GET_WHEEL_DELTA_WPARAM(wParam) > 0 ? 1.25 : 0.8;
+        event.x = p.x;
+        event.y = p.y;
+        break;
+    }
+    case WM_LBUTTONDOWN:
+        viewer->BeginDrag(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+        SetCapture(hwnd);
+        return 0;
+    case WM_MOUSEMOVE:
+        if (!viewer->DragTo(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam), event))
+            return 0;
+        break;
+    case WM_LBUTTONUP:
+        viewer->EndDrag();
+        ReleaseCapture();
+        return 0;
+    case WM_RBUTTONDOWN:
+        event.kind = ViewEvent::Reset;
+        break;
+    case WM_DESTROY:
+        PostQuitMessage(0);
+        return 0;
+    default:
+        return DefWindowProcA(hwnd, message, wParam, lParam);
+    }
+    viewer->Dispatch(event, [](const FrameBuffer &) {});
+    return 0;
+}
+
+// Open a window for viewer and run its message loop until the window is closed
+inline void RunPlotViewerWindow(PlotViewer &viewer, const char *title)
+{
+    const char CLASS_NAME[] = "Plot Viewer Window Class";
+
+    WNDCLASSA wc = {};
+    wc.lpfnWndProc = PlotViewerWndProc;
+    wc.hInstance = GetModuleHandle(NULL);
+    wc.lpszClassName = CLASS_NAME;
+    wc.hCursor = LoadCursor(NULL, IDC_ARROW);
+    RegisterClassA(&wc);
+
+    // Size the window so the client area matches the canvas
+    RECT rect = {0, 0, viewer.Width(), viewer.Height()};
+    DWORD style = WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU | WS_MINIMIZEBOX;
+    AdjustWindowRect(&rect, style, FALSE);
+
+    HWND hwnd = CreateWindowExA(
+        0,
+        CLASS_NAME,
+        title,
+        style,
+        CW_USEDEFAULT, CW_USEDEFAULT, rect.right - rect.left, rect.bottom - rect.top,
+        NULL,
+        NULL,
+        GetModuleHandle(NULL),
+        &viewer);
+
+    if (hwnd == NULL)
+    {
+        return;
+    }
+
+    viewer.SetFrameReadyCallback([hwnd]()
+                                 { PostMessageA(hwnd, PLOT_VIEWER_FRAME_READY, 0, 0); });
+    viewer.Start();
+    viewer.RequestRender();
+    ShowWindow(hwnd, SW_SHOW);
+
+    MSG msg = {};
+    while (GetMessage(&msg, NULL, 0, 0))
+    {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+    viewer.Stop();
+}
+#endif
@@ -0,0 +1,552 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "Bitmap.h"
+#include "Palette.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PLOT_RASTER_SSE2 1
+#endif
+using namespace std;
+
+// How series are drawn: GDI pens and brushes (aliased), or the anti-aliased
+// software rasterizer below writing straight into the pixel buffer.
+enum class RasterMode
+{
+    GDI,
+    Software
+};
+
+// Scatter marker shapes. Circle and Square are outlined sprites; Point is a
+// single opaque pixel for very dense point clouds.
+enum class MarkerStyle
+{
+    Circle,
+    Square,
+    Point
+};
+
+inline uint32_t PackBGRA(RGBColor color)
+{
+    return 0xFF000000u | (static_cast<uint32_t>(color.r) << 16) | (static_cast<uint32_t>(color.g) << 8) | static_cast<uint32_t>(color.b);
+}
+
+// x / 255 rounded, exact for x in [0, 255 * 255]
+inline uint32_t DivideBy255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+// dst = color * coverage + dst * (1 - coverage) for n pixels, coverage in 0..255
+inline void BlendCoverageSpan(uint32_t *dst, const uint8_t *coverage, int n, uint32_t color)
+{
+    int i = 0;
+#ifdef PLOT_RASTER_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i src = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color)), zero);
+    for (; i + 16 <= n; i += 16)
+    {
+        // Masks are mostly empty around thin lines; skip 16 pixels at a time
+        __m128i cov16 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(coverage + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(cov16, zero)) == 0xFFFF)
+            continue;
+        for (int j = 0; j < 16; j += 4)
+        {
+            // Broadcast each pixel's coverage to its four channels as 16-bit lanes
+            int32_t cov4;
+            memcpy(&cov4, coverage + i + j, sizeof(cov4));
+            __m128i a = _mm_cvtsi32_si128(cov4);
+            a = _mm_unpacklo_epi8(a, a);
+            a = _mm_unpacklo_epi16(a, a);
+            __m128i a_lo = _mm_unpacklo_epi8(a, zero);
+            __m128i a_hi = _mm_unpackhi_epi8(a, zero);
+
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i + j));
+            __m128i d_lo = _mm_unpacklo_epi8(d, zero);
+            __m128i d_hi = _mm_unpackhi_epi8(d, zero);
+
+            __m128i r_lo = _mm_add_epi16(_mm_mullo_epi16(d_lo, _mm_sub_epi16(full, a_lo)), _mm_mullo_epi16(src, a_lo));
+            __m128i r_hi = _mm_add_epi16(_mm_mullo_epi16(d_hi, _mm_sub_epi16(full, a_hi)), _mm_mullo_epi16(src, a_hi));
+            r_lo = _mm_add_epi16(r_lo, bias);
+            r_hi = _mm_add_epi16(r_hi, bias);
+            r_lo = _mm_srli_epi16(_mm_add_epi16(r_lo, _mm_srli_epi16(r_lo, 8)), 8);
+            r_hi = _mm_srli_epi16(_mm_add_epi16(r_hi, _mm_srli_epi16(r_hi, 8)), 8);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + j), _mm_packus_epi16(r_lo, r_hi));
+        }
+    }
+#endif
+    for (; i < n; i++)
+    {
+        uint32_t a = coverage[i];
+        if (a == 0)
+            continue;
+        uint32_t d = dst[i];
+        uint32_t result = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            uint32_t dc = (d >> shift) & 0xFF;
+            uint32_t sc = (color >> shift) & 0xFF;
+            result |= DivideBy255(dc * (255 - a) + sc * a) << shift;
+        }
+        dst[i] = result;
+    }
+}
+
+// dst = src + dst * (1 - src.alpha) for n premultiplied BGRA source pixels
+inline void BlendPremultipliedSpan(uint32_t *dst, const uint32_t *src, int n)
+{
+    int i = 0;
+#ifdef PLOT_RASTER_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i full = _mm_set1_epi16(255);
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i s_lo = _mm_unpacklo_epi8(s, zero);
+        __m128i s_hi = _mm_unpackhi_epi8(s, zero);
+        __m128i a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i d_lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(full, a_lo));
+        __m128i d_hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(full, a_hi));
+        d_lo = _mm_add_epi16(d_lo, bias);
+        d_hi = _mm_add_epi16(d_hi, bias);
+        d_lo = _mm_srli_epi16(_mm_add_epi16(d_lo, _mm_srli_epi16(d_lo, 8)), 8);
+        d_hi = _mm_srli_epi16(_mm_add_epi16(d_hi, _mm_srli_epi16(d_hi, 8)), 8);
+        __m128i r = _mm_adds_epu8(_mm_packus_epi16(d_lo, d_hi), s);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), r);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        uint32_t s = src[i];
+        uint32_t a = s >> 24;
+        if (a == 0)
+            continue;
+        uint32_t d = dst[i];
+        uint32_t result = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            uint32_t channel = DivideBy255(((d >> shift) & 0xFF) * (255 - a)) + ((s >> shift) & 0xFF);
+            result |= std::min(channel, 255u) << shift;
+        }
+        dst[i] = result;
+    }
+}
+
+// Liang-Barsky: clip the segment to [left, right] x [top, bottom] in place.
+// Returns false when no part of it lies inside. Clip in double when the
+// endpoints may be far outside, or the clipped ends lose their precision.
+template <typename T>
+inline bool ClipSegmentToRect(T &x0, T &y0, T &x1, T &y1, T left, T top, T right, T bottom)
+{
+    T dx = x1 - x0;
+    T dy = y1 - y0;
+    T t0 = 0, t1 = 1;
+    const T p[4] = {-dx, dx, -dy, dy};
+    const T q[4] = {x0 - left, right - x0, y0 - top, bottom - y0};
+    for (int k = 0; k < 4; k++)
+    {
+        if (p[k] == 0)
+        {
+            if (q[k] < 0)
+                return false;
+            continue;
+        }
+        T t = q[k] / p[k];
+        if (p[k] < 0)
+            t0 = std::max(t0, t);
+        else
+            t1 = std::min(t1, t);
+    }
+    if (t0 > t1)
+        return false;
+    T sx = x0, sy = y0;
+    x0 = sx + t0 * dx;
+    y0 = sy + t0 * dy;
+    x1 = sx + t1 * dx;
+    y1 = sy + t1 * dy;
+    return true;
+}
+
+struct ScreenPoint
+{
+    float x;
+    float y;
+};
+
+// Sutherland-Hodgman: clip a closed polygon to [left, right] x [top, bottom].
+// Concave outlines such as bands stay correct for filling, though the result
+// may run along the rect's edges between separate pieces.
+inline void ClipPolygonToRect(const vector<ScreenPoint> &polygon, float left, float top, float right, float bottom, vector<ScreenPoint> &out, vector<ScreenPoint> &scratch)
+{
+    out = polygon;
+    // Edge k keeps points with inside(k, p) >= 0; intersections are found in
+    // double and land exactly on the edge
+    auto inside = [&](int k, const ScreenPoint &p) -> double
+    {
+        switch (k)
+        {
+        case 0:
+            return p.x - left;
+        case 1:
+            return right - p.x;
+        case 2:
+            return p.y - top;
+        default:
+            return bottom - p.y;
+        }
+    };
+    for (int k = 0; k < 4 && !out.empty(); k++)
+    {
+        scratch.swap(out);
+        out.clear();
+        for (size_t i = 0; i < scratch.size(); i++)
+        {
+            const ScreenPoint &a = scratch[i == 0 ? scratch.size() - 1 : i - 1];
+            const ScreenPoint &b = scratch[i];
+            double da = inside(k, a), db = inside(k, b);
+            if ((da >= 0.0) != (db >= 0.0))
+            {
+                double t = da / (da - db);
+                ScreenPoint crossing = {static_cast<float>(a.x + t * (double(b.x) - a.x)), static_cast<float>(a.y + t * (double(b.y) - a.y))};
+                if (k < 2)
+                    crossing.x = k == 0 ? left : right;
+                else
+                    crossing.y = k == 2 ? top : bottom;
+                out.push_back(crossing);
+            }
+            if (db >= 0.0)
+                out.push_back(b);
+        }
+    }
+}
+
+// Anti-aliased drawing into a 32-bit BGRA surface.
+//
+// Lines are rasterized analytically: each pixel's coverage is how far its
+// center lies inside the stroke, accumulated with max() into an 8-bit mask
+// so joints and overlaps within one polyline are not blended twice. The mask
+// is then composited once per color with BlendCoverageSpan. Markers are
+// pre-rasterized (4x4 supersampled) premultiplied sprites, built once per
+// color and radius and stamped row by row with BlendPremultipliedSpan.
+class SoftwareRasterizer
+{
+public:
+    struct MarkerSprite
+    {
+        uint32_t color;
+        int radius;
+        MarkerStyle style;
+        int size;
+        vector<uint32_t> pixels; // premultiplied BGRA, size x size
+    };
+
+private:
+    PixelSurface surface;
+    int clip_left, clip_top, clip_right, clip_bottom; // right and bottom are exclusive
+    vector<uint8_t> mask;                             // coverage for the polyline being built
+    int dirty_left, dirty_top, dirty_right, dirty_bottom;
+    vector<MarkerSprite> sprites;
+
+    void ResetDirty()
+    {
+        dirty_left = surface.width;
+        dirty_top = surface.height;
+        dirty_right = 0;
+        dirty_bottom = 0;
+    }
+
+    // Liang-Barsky clip against the clip rectangle grown by margin. Keeps
+    // the per-row spans bounded and the coordinates small when zoomed in.
+    bool ClipSegment(float &x0, float &y0, float &x1, float &y1, float margin) const
+    {
+        return ClipSegmentToRect<float>(x0, y0, x1, y1, clip_left - margin, clip_top - margin, clip_right + margin, clip_bottom + margin);
+    }
+
+public:
+    explicit SoftwareRasterizer(PixelSurface target)
+        : surface(target)
+    {
+        mask.assign(static_cast<size_t>(surface.width) * surface.height, 0);
+        ResetClip();
+        ResetDirty();
+    }
+
+    void SetClip(int left, int top, int right, int bottom)
+    {
+        clip_left = std::max(left, 0);
+        clip_top = std::max(top, 0);
+        clip_right = std::min(right, surface.width);
+        clip_bottom = std::min(bottom, surface.height);
+    }
+    void ResetClip()
+    {
+        SetClip(0, 0, surface.width, surface.height);
+    }
+
+    // Accumulate an anti-aliased stroke of the given width into the coverage mask
+    void AddLine(float x0, float y0, float x1, float y1, float width = 1.0f)
+    {
+        if (!std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1))
+            return;
+        const float half = 0.5f * width;
+        const float reach = half + 0.5f; // coverage is zero beyond this distance
+        if (!ClipSegment(x0, y0, x1, y1, reach + 1.0f))
+            return;
+
+        const float dx = x1 - x0;
+        const float dy = y1 - y0;
+        const float length2 = dx * dx + dy * dy;
+        const float inv_length2 = length2 > 0.0f ? 1.0f / length2 : 0.0f;
+        const float x_slope = std::fabs(dy) > 1e-6f ? dx / dy : 0.0f;
+        // Half-width in x of the stroke at one row; unbounded for horizontal lines
+        const float half_span = std::fabs(dy) > 1e-6f ? reach * std::sqrt(length2) / std::fabs(dy) + 1.0f : 1e30f;
+        const float min_x = std::min(x0, x1) - reach;
+        const float max_x = std::max(x0, x1) + reach;
+
+        int top = std::max(clip_top, static_cast<int>(std::floor(std::min(y0, y1) - reach)));
+        int bottom = std::min(clip_bottom, static_cast<int>(std::ceil(std::max(y0, y1) + reach)) + 1);
+        for (int py = top; py < bottom; py++)
+        {
+            float cy = py + 0.5f;
+            float line_x = std::fabs(dy) > 1e-6f ? x0 + (cy - y0) * x_slope : x0;
+            float span_left = std::max(min_x, line_x - half_span);
+            float span_right = std::min(max_x, line_x + half_span);
+            int left = std::max(clip_left, static_cast<int>(std::floor(span_left)));
+            int right = std::min(clip_right, static_cast<int>(std::ceil(span_right)) + 1);
+            if (left >= right)
+                continue;
+
+            uint8_t *row = mask.data() + static_cast<size_t>(py) * surface.width;
+            bool touched = false;
+            for (int px = left; px < right; px++)
+            {
+                float cx = px + 0.5f;
+                float t = ((cx - x0) * dx + (cy - y0) * dy) * inv_length2;
+                t = std::min(std::max(t, 0.0f), 1.0f);
+                float ex = cx - (x0 + t * dx);
+                float ey = cy - (y0 + t * dy);
+                float coverage = reach - std::sqrt(ex * ex + ey * ey);
+                if (coverage <= 0.0f)
+                    continue;
+                uint8_t value = static_cast<uint8_t>(std::min(coverage, 1.0f) * 255.0f + 0.5f);
+                row[px] = std::max(row[px], value);
+                touched = true;
+            }
+            if (touched)
+            {
+                dirty_left = std::min(dirty_left, left);
+                dirty_right = std::max(dirty_right, right);
+                dirty_top = std::min(dirty_top, py);
+                dirty_bottom = std::max(dirty_bottom, py + 1);
+            }
+        }
+    }
+
+    // Accumulate the area between two polylines sharing ascending x into the
+    // coverage mask. Each pixel column is filled between the interpolated
+    // edges, with fractional coverage on the first and last row.
+    void AddBand(const float *x, const float *lower, const float *upper, size_t n)
+    {
+        for (size_t i = 0; i + 1 < n; i++)
+        {
+            float x0 = x[i], x1 = x[i + 1];
+            if (!(x1 > x0) || !std::isfinite(x0) || !std::isfinite(x1))
+                continue;
+            if (x1 <= clip_left || x0 >= clip_right)
+                continue;
+            int left = std::max(clip_left, static_cast<int>(std::floor(std::max(x0, static_cast<float>(clip_left)) - 0.5f)));
+            int right = std::min(clip_right, static_cast<int>(std::ceil(std::min(x1, static_cast<float>(clip_right)))));
+            float inv_width = 1.0f / (x1 - x0);
+            for (int px = left; px < right; px++)
+            {
+                float cx = px + 0.5f;
+                if (cx < x0 || cx >= x1)
+                    continue;
+                float t = (cx - x0) * inv_width;
+                float a = lower[i] + t * (lower[i + 1] - lower[i]);
+                float b = upper[i] + t * (upper[i + 1] - upper[i]);
+                float top = std::max(std::min(a, b), static_cast<float>(clip_top));
+                float bottom = std::min(std::max(a, b), static_cast<float>(clip_bottom));
+                if (!(bottom > top))
+                    continue;
+                int first = static_cast<int>(std::floor(top));
+                int last = std::min(clip_bottom, static_cast<int>(std::ceil(bottom)));
+                for (int py = first; py < last; py++)
+                {
+                    float covered = std::min(py + 1.0f, bottom) - std::max(static_cast<float>(py), top);
+                    uint8_t value = static_cast<uint8_t>(std::min(covered, 1.0f) * 255.0f + 0.5f);
+                    uint8_t &cell = mask[static_cast<size_t>(py) * surface.width + px];
+                    cell = std::max(cell, value);
+                }
+                dirty_left = std::min(dirty_left, px);
+                dirty_right = std::max(dirty_right, px + 1);
+                dirty_top = std::min(dirty_top, first);
+                dirty_bottom = std::max(dirty_bottom, last);
+            }
+        }
+    }
+
+    // Composite the accumulated coverage in one color and clear the mask.
+    // Opacity below 255 draws translucent fills such as confidence bands.
+    void FillMask(RGBColor color, uint8_t opacity = 255)
+    {
+        if (dirty_left >= dirty_right || dirty_top >= dirty_bottom)
+            return;
+        uint32_t packed = PackBGRA(color);
+        int n = dirty_right - dirty_left;
+        for (int py = dirty_top; py < dirty_bottom; py++)
+        {
+            uint8_t *row = mask.data() + static_cast<size_t>(py) * surface.width + dirty_left;
+            if (opacity != 255)
+            {
+                for (int i = 0; i < n; i++)
+                    row[i] = static_cast<uint8_t>(DivideBy255(row[i] * opacity));
+            }
+            BlendCoverageSpan(surface.pixels + static_cast<size_t>(py) * surface.stride + dirty_left, row, n, packed);
+            memset(row, 0, n);
+        }
+        ResetDirty();
+    }
+
+    void DrawLine(float x0, float y0, float x1, float y1, RGBColor color, float width = 1.0f)
+    {
+        AddLine(x0, y0, x1, y1, width);
+        FillMask(color);
+    }
+
+    // Solid pixel-aligned rectangle, right and bottom exclusive
+    void FillRect(int left, int top, int right, int bottom, RGBColor color)
+    {
+        left = std::max(left, clip_left);
+        top = std::max(top, clip_top);
+        right = std::min(right, clip_right);
+        bottom = std::min(bottom, clip_bottom);
+        uint32_t packed = PackBGRA(color);
+        for (int py = top; py < bottom; py++)
+        {
+            uint32_t *row = surface.pixels + static_cast<size_t>(py) * surface.stride;
+            std::fill(row + left, row + std::max(left, right), packed);
+        }
+    }
+
+    // Sprite for a marker of this color, radius and style, built on first use.
+    // Same shape as the GDI marker: a disc (or square) of the given radius
+    // with a one pixel black outline, centered on a pixel corner.
+    const MarkerSprite &Sprite(uint32_t color, int radius, MarkerStyle style = MarkerStyle::Circle)
+    {
+        for (const MarkerSprite &sprite : sprites)
+        {
+            if (sprite.color == color && sprite.radius == radius && sprite.style == style)
+                return sprite;
+        }
+
+        MarkerSprite sprite;
+        sprite.color = color;
+        sprite.radius = radius;
+        sprite.style = style;
+        sprite.size = 2 * radius + 2;
+        sprite.pixels.assign(static_cast<size_t>(sprite.size) * sprite.size, 0);
+        const int samples = 4;
+        const float center = radius + 1.0f;
+        const float outer = static_cast<float>(radius);
+        const float inner = std::max(outer - 1.0f, 0.0f);
+        auto inside = [style](float x, float y, float r)
+        {
+            if (style == MarkerStyle::Square)
+                return std::max(std::fabs(x), std::fabs(y)) <= r;
+            return x * x + y * y <= r * r;
+        };
+        for (int py = 0; py < sprite.size; py++)
+        {
+            for (int px = 0; px < sprite.size; px++)
+            {
+                int outer_hits = 0, inner_hits = 0;
+                for (int sy = 0; sy < samples; sy++)
+                {
+                    for (int sx = 0; sx < samples; sx++)
+                    {
+                        float x = px + (sx + 0.5f) / samples - center;
+                        float y = py + (sy + 0.5f) / samples - center;
+                        outer_hits += inside(x, y, outer);
+                        inner_hits += inside(x, y, inner);
+                    }
+                }
+                uint32_t alpha = DivideBy255(outer_hits * 255 * 255 / (samples * samples));
+                uint32_t fill = DivideBy255(inner_hits * 255 * 255 / (samples * samples));
+                // Premultiplied: the fill contributes color, the outline is black
+                uint32_t pixel = alpha << 24;
+                for (int shift = 0; shift < 24; shift += 8)
+                    pixel |= DivideBy255(((color >> shift) & 0xFF) * fill) << shift;
+                sprite.pixels[py * sprite.size + px] = pixel;
+            }
+        }
+        sprites.push_back(std::move(sprite));
+        return sprites.back();
+    }
+
+    // Blend a sprite with its top-left corner at (ox, oy), clipped
+    void StampSprite(const MarkerSprite &sprite, int ox, int oy)
+    {
+        int left = std::max(ox, clip_left);
+        int right = std::min(ox + sprite.size, clip_right);
+        int top = std::max(oy, clip_top);
+        int bottom = std::min(oy + sprite.size, clip_bottom);
+        for (int py = top; py < bottom; py++)
+        {
+            const uint32_t *src = sprite.pixels.data() + (py - oy) * sprite.size + (left - ox);
+            BlendPremultipliedSpan(surface.pixels + static_cast<size_t>(py) * surface.stride + left, src, right - left);
+        }
+    }
+
+    // Opaque write of a packed color; the caller has already clipped (x, y)
+    void PutPixel(int x, int y, uint32_t packed)
+    {
+        surface.pixels[static_cast<size_t>(y) * surface.stride + x] = packed;
+    }
+
+    int ClipLeft() const
+    {
+        return clip_left;
+    }
+    int ClipTop() const
+    {
+        return clip_top;
+    }
+    int ClipRight() const
+    {
+        return clip_right;
+    }
+    int ClipBottom() const
+    {
+        return clip_bottom;
+    }
+
+    // Stamp an outlined marker centered on the pixel corner at (x, y)
+    void DrawMarker(float x, float y, RGBColor color, int radius = 4, MarkerStyle style = MarkerStyle::Circle)
+    {
+        if (!std::isfinite(x) || !std::isfinite(y))
+            return;
+        if (style == MarkerStyle::Point)
+        {
+            if (x >= clip_left && x < clip_right && y >= clip_top && y < clip_bottom)
+                PutPixel(static_cast<int>(x), static_cast<int>(y), PackBGRA(color));
+            return;
+        }
+        const MarkerSprite &sprite = Sprite(PackBGRA(color), radius, style);
+        float origin_x = std::floor(x) - (radius + 1);
+        float origin_y = std::floor(y) - (radius + 1);
+        if (origin_x >= clip_right || origin_y >= clip_bottom || origin_x + sprite.size <= clip_left || origin_y + sprite.size <= clip_top)
+            return;
+        StampSprite(sprite, static_cast<int>(origin_x), static_cast<int>(origin_y));
+    }
+};
@@ -0,0 +1,390 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "SeriesStore.h"
+using namespace std;
+
+// Statistical summaries of a series, drawn as a center line over a filled
+// lower..upper band. Each reduction reads its source columns in a single
+// pass and writes one output point per window position or x bin.
+
+enum class ReductionKind
+{
+    Rolling,     // trailing window of points: mean line, min..max band
+    Percentiles, // x bins: median line, quantile band from a t-digest per bin
+    Envelope     // x bins: mean line, min..max band
+};
+
+struct ReductionSpec
+{
+    ReductionKind kind = ReductionKind::Rolling;
+    size_t window = 0;           // Rolling: points per window
+    int bins = 0;                // Percentiles, Envelope: equal-width bins over the x range
+    double lower_quantile = 0.0; // Percentiles
+    double upper_quantile = 1.0;
+};
+
+struct ReducedSeries
+{
+    vector<double> x;
+    vector<double> center;
+    vector<double> lower;
+    vector<double> upper;
+
+    void Clear()
+    {
+        x.clear();
+        center.clear();
+        lower.clear();
+        upper.clear();
+    }
+    size_t Size() const
+    {
+        return x.size();
+    }
+};
+
+// Merging t-digest (Dunning): a streaming quantile sketch whose error is
+// smallest in the tails, which is where percentile bands live. Values are
+// buffered, then merged into at most ~compression centroids.
+class TDigest
+{
+private:
+    struct Centroid
+    {
+        double mean;
+        double weight;
+        bool operator<(const Centroid &other) const
+        {
+            return mean < other.mean;
+        }
+    };
+
+    double compression;
+    vector<Centroid> centroids; // sorted by mean once compressed
+    vector<Centroid> buffer;
+    vector<Centroid> merged;    // reused by Compress
+    double total_weight;
+    double min_value;
+    double max_value;
+
+    static constexpr double Pi = 3.14159265358979323846;
+
+    // k1 scale function and its inverse; one centroid spans at most one unit of k
+    double ScaleK(double q) const
+    {
+        return compression / (2.0 * Pi) * asin(2.0 * q - 1.0);
+    }
+    double InverseK(double k) const
+    {
+        return (sin(k * 2.0 * Pi / compression) + 1.0) / 2.0;
+    }
+
+public:
+    explicit TDigest(double compression_factor = 100.0)
+    {
+        compression = compression_factor;
+        Reset();
+    }
+    void Reset()
+    {
+        centroids.clear();
+        buffer.clear();
+        total_weight = 0.0;
+        min_value = numeric_limits<double>::infinity();
+        max_value = -numeric_limits<double>::infinity();
+    }
+    void Add(double value, double weight = 1.0)
+    {
+        if (std::isnan(value))
+            return;
+        buffer.push_back({value, weight});
+        total_weight += weight;
+        min_value = std::min(min_value, value);
+        max_value = std::max(max_value, value);
+        if (buffer.size() >= static_cast<size_t>(5 * compression))
+            Compress();
+    }
+    double Count() const
+    {
+        return total_weight;
+    }
+
+    void Compress()
+    {
+        if (buffer.empty())
+            return;
+        sort(buffer.begin(), buffer.end());
+        merged.resize(centroids.size() + buffer.size());
+        std::merge(centroids.begin(), centroids.end(), buffer.begin(), buffer.end(), merged.begin());
+        buffer.clear();
+        centroids.clear();
+
+        Centroid current = merged[0];
+        double weight_so_far = 0.0;
+        double q_limit = InverseK(ScaleK(0.0) + 1.0);
+        for (size_t i = 1; i < merged.size(); i++)
+        {
+            const Centroid &next = merged[i];
+            double q = (weight_so_far + current.weight + next.weight) / total_weight;
+            if (q <= q_limit)
+            {
+                current.weight += next.weight;
+                current.mean += (next.mean - current.mean) * next.weight / current.weight;
+            }
+            else
+            {
+                weight_so_far += current.weight;
+                centroids.push_back(current);
+                q_limit = InverseK(ScaleK(weight_so_far / total_weight) + 1.0);
+                current = next;
+            }
+        }
+        centroids.push_back(current);
+    }
+
+    // Value below which a fraction q of the added weight lies, interpolating between centroid centers
+    double Quantile(double q)
+    {
+        Compress();
+        if (centroids.empty())
+            return numeric_limits<double>::quiet_NaN();
+        if (centroids.size() == 1)
+            return centroids[0].mean;
+        q = std::min(std::max(q, 0.0), 1.0);
+        double target = q * total_weight;
+
+        const Centroid &first = centroids.front();
+        if (target < first.weight / 2.0)
+            return min_value + (first.mean - min_value) * target / (first.weight / 2.0);
+        const Centroid &last = centroids.back();
+        if (target > total_weight - last.weight / 2.0)
+        {
+            double tail = total_weight - target;
+            return max_value - (max_value - last.mean) * tail / (last.weight / 2.0);
+        }
+
+        double cumulative = 0.0;
+        for (size_t i = 0; i + 1 < centroids.size(); i++)
+        {
+            double left = cumulative + centroids[i].weight / 2.0;
+            double right = cumulative + centroids[i].weight + centroids[i + 1].weight / 2.0;
+            if (target <= right)
+            {
+                double t = (target - left) / (right - left);
+                return centroids[i].mean + t * (centroids[i + 1].mean - centroids[i].mean);
+            }
+            cumulative += centroids[i].weight;
+        }
+        return last.mean;
+    }
+};
+
+// Call fn(const X *x, const Y *y, size_t n) with both columns at their stored types
+template <typename Fn>
+void VisitPair(const Column &x_column, const Column &y_column, Fn fn)
+{
+    x_column.Visit([&](const auto *x, size_t nx)
+                   { y_column.Visit([&](const auto *y, size_t ny)
+                                    { fn(x, y, std::min(nx, ny)); }); });
+}
+
+// Trailing window mean, min and max. Min and max come from monotonic
+// queues, so the pass is O(n) whatever the window size. Points with a NaN or
+// infinite coordinate are skipped and do not count towards the window.
+inline void RollingWindow(const Column &x_column, const Column &y_column, size_t window, ReducedSeries &out)
+{
+    out.Clear();
+    // A window longer than the series behaves like the whole series; cap it so the queues stay small
+    size_t points = std::min(x_column.Size(), y_column.Size());
+    window = std::min(std::max<size_t>(window, 1), std::max<size_t>(points, 1));
+    VisitPair(x_column, y_column, [&](const auto *x, const auto *y, size_t n)
+              {
+                  out.x.resize(n);
+                  out.center.resize(n);
+                  out.lower.resize(n);
+                  out.upper.resize(n);
+                  // Queue entries are (position among kept points, value); ring
+                  // buffers hold at most window entries each
+                  struct Entry
+                  {
+                      size_t position;
+                      double value;
+                  };
+                  vector<Entry> min_queue(window), max_queue(window);
+                  vector<double> recent(window); // the last window kept values, for the running sum
+                  size_t min_head = 0, min_count = 0, max_head = 0, max_count = 0;
+                  auto wrap = [window](size_t position)
+                  { return position >= window ? position - window : position; };
+                  double sum = 0.0;
+                  size_t kept = 0, slot = 0;
+                  for (size_t i = 0; i < n; i++)
+                  {
+                      double x_value = ToAxisValue(x[i]);
+                      double value = ToAxisValue(y[i]);
+                      if (!std::isfinite(x_value) || !std::isfinite(value))
+                          continue;
+                      sum += value;
+                      if (kept >= window)
+                          sum -= recent[slot];
+                      recent[slot] = value;
+                      slot = wrap(slot + 1);
+
+                      // Drop entries that left the window, then dominated ones from the back
+                      if (min_count > 0 && min_queue[min_head].position + window <= kept)
+                      {
+                          min_head = wrap(min_head + 1);
+                          min_count--;
+                      }
+                      while (min_count > 0 && min_queue[wrap(min_head + min_count - 1)].value >= value)
+                          min_count--;
+                      min_queue[wrap(min_head + min_count)] = {kept, value};
+                      min_count++;
+
+                      if (max_count > 0 && max_queue[max_head].position + window <= kept)
+                      {
+                          max_head = wrap(max_head + 1);
+                          max_count--;
+                      }
+                      while (max_count > 0 && max_queue[wrap(max_head + max_count - 1)].value <= value)
+                          max_count--;
+                      max_queue[wrap(max_head + max_count)] = {kept, value};
+                      max_count++;
+
+                      out.x[kept] = x_value;
+                      out.center[kept] = sum / static_cast<double>(std::min(kept + 1, window));
+                      out.lower[kept] = min_queue[min_head].value;
+                      out.upper[kept] = max_queue[max_head].value;
+                      kept++;
+                  }
+                  out.x.resize(kept);
+                  out.center.resize(kept);
+                  out.lower.resize(kept);
+                  out.upper.resize(kept); });
+}
+
+// x range of the column's finite values. Column::Min and Max take in
+// infinities, which would make every bin infinitely wide.
+inline void FiniteRange(const Column &column, double &lowest, double &highest)
+{
+    lowest = column.Min();
+    highest = column.Max();
+    if (std::isfinite(lowest) && std::isfinite(highest))
+        return;
+    lowest = numeric_limits<double>::infinity();
+    highest = -numeric_limits<double>::infinity();
+    column.Visit([&](const auto *data, size_t n)
+                 {
+                     for (size_t i = 0; i < n; i++)
+                     {
+                         double value = ToAxisValue(data[i]);
+                         if (std::isfinite(value))
+                         {
+                             lowest = std::min(lowest, value);
+                             highest = std::max(highest, value);
+                         }
+                     } });
+}
+
+// Equal-width bin of x over the column's range; the last bin is closed. The
+// bin is clamped before the conversion to int, which would be undefined for
+// NaN or out-of-range positions.
+inline int BinOf(double x, double x_min, double bin_width, int bins)
+{
+    if (!(bin_width > 0.0))
+        return 0;
+    double position = (x - x_min) / bin_width;
+    if (!(position > 0.0))
+        return 0;
+    if (position >= bins)
+        return bins - 1;
+    return static_cast<int>(position);
+}
+
+// Per-bin min, max and mean of y; empty bins produce no output point. Points
+// with a NaN or infinite coordinate are skipped.
+inline void Envelope(const Column &x_column, const Column &y_column, int bins, ReducedSeries &out)
+{
+    out.Clear();
+    bins = std::max(bins, 1);
+    double x_min, x_max;
+    FiniteRange(x_column, x_min, x_max);
+    double bin_width = (x_max - x_min) / bins;
+    vector<double> lower(bins, numeric_limits<double>::infinity());
+    vector<double> upper(bins, -numeric_limits<double>::infinity());
+    vector<double> sum(bins, 0.0);
+    vector<size_t> count(bins, 0);
+    VisitPair(x_column, y_column, [&](const auto *x, const auto *y, size_t n)
+              {
+                  for (size_t i = 0; i < n; i++)
+                  {
+                      double x_value = ToAxisValue(x[i]);
+                      double value = ToAxisValue(y[i]);
+                      if (!std::isfinite(x_value) || !std::isfinite(value))
+                          continue;
+                      int bin = BinOf(x_value, x_min, bin_width, bins);
+                      lower[bin] = std::min(lower[bin], value);
+                      upper[bin] = std::max(upper[bin], value);
+                      sum[bin] += value;
+                      count[bin]++;
+                  } });
+    for (int bin = 0; bin < bins; bin++)
+    {
+        if (count[bin] == 0)
+            continue;
+        out.x.push_back(x_min + (bin + 0.5) * bin_width);
+        out.center.push_back(sum[bin] / count[bin]);
+        out.lower.push_back(lower[bin]);
+        out.upper.push_back(upper[bin]);
+    }
+}
+
+// Per-bin median and quantile band from one t-digest per bin. Points with a
+// NaN or infinite coordinate are skipped.
+inline void PercentileBand(const Column &x_column, const Column &y_column, int bins, double lower_quantile, double upper_quantile, ReducedSeries &out)
+{
+    out.Clear();
+    bins = std::max(bins, 1);
+    double x_min, x_max;
+    FiniteRange(x_column, x_min, x_max);
+    double bin_width = (x_max - x_min) / bins;
+    vector<TDigest> digests(bins);
+    VisitPair(x_column, y_column, [&](const auto *x, const auto *y, size_t n)
+              {
+                  for (size_t i = 0; i < n; i++)
+                  {
+                      double x_value = ToAxisValue(x[i]);
+                      double value = ToAxisValue(y[i]);
+                      if (!std::isfinite(x_value) || !std::isfinite(value))
+                          continue;
+                      digests[BinOf(x_value, x_min, bin_width, bins)].Add(value);
+                  } });
+    for (int bin = 0; bin < bins; bin++)
+    {
+        if (digests[bin].Count() == 0)
+            continue;
+        out.x.push_back(x_min + (bin + 0.5) * bin_width);
+        out.center.push_back(digests[bin].Quantile(0.5));
+        out.lower.push_back(digests[bin].Quantile(lower_quantile));
+        out.upper.push_back(digests[bin].Quantile(upper_quantile));
+    }
+}
+
+inline void Reduce(const ReductionSpec &spec, const Column &x_column, const Column &y_column, ReducedSeries &out)
+{
+    switch (spec.kind)
+    {
+    case ReductionKind::Rolling:
+        RollingWindow(x_column, y_column, spec.window, out);
+        break;
+    case ReductionKind::Percentiles:
+        PercentileBand(x_column, y_column, spec.bins, spec.lower_quantile, spec.upper_quantile, out);
+        break;
+    case ReductionKind::Envelope:
+        Envelope(x_column, y_column, spec.bins, out);
+        break;
+    }
+}
@@ -0,0 +1,334 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <chrono>
+using namespace std;
+
+// Streaming 64-bit content hash following the XXH64 construction
+class ContentHasher
+{
+private:
+    static constexpr uint64_t Prime1 = 11400714785074694791ULL;
+    static constexpr uint64_t Prime2 = 14029467366897019727ULL;
+    static constexpr uint64_t Prime3 = 1609587929392839161ULL;
+    static constexpr uint64_t Prime4 = 9650029242287828579ULL;
+    static constexpr uint64_t Prime5 = 2870177450012600261ULL;
+
+    uint64_t seed;
+    uint64_t v1, v2, v3, v4;
+    uint64_t total_length;
+    unsigned char buffer[32];
+    size_t buffered;
+
+    static uint64_t Rotl(uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+    static uint64_t Round(uint64_t acc, uint64_t input)
+    {
+        acc += input * Prime2;
+        acc = Rotl(acc, 31);
+        return acc * Prime1;
+    }
+    static uint64_t MergeRound(uint64_t acc, uint64_t value)
+    {
+        acc ^= Round(0, value);
+        return acc * Prime1 + Prime4;
+    }
+    static uint64_t Read64(const unsigned char *p)
+    {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    static uint32_t Read32(const unsigned char *p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    void ConsumeStripe(const unsigned char *p)
+    {
+        v1 = Round(v1, Read64(p));
+        v2 = Round(v2, Read64(p + 8));
+        v3 = Round(v3, Read64(p + 16));
+        v4 = Round(v4, Read64(p + 24));
+    }
+
+public:
+    ContentHasher(uint64_t hash_seed = 0)
+    {
+        seed = hash_seed;
+        v1 = seed + Prime1 + Prime2;
+        v2 = seed + Prime2;
+        v3 = seed;
+        v4 = seed - Prime1;
+        total_length = 0;
+        buffered = 0;
+    }
+
+    void Update(const void *data, size_t length)
+    {
+        // Empty containers may hand over a null pointer, which memcpy must not see
+        if (length == 0)
+            return;
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        total_length += length;
+
+        // Top up a partially filled stripe first
+        if (buffered > 0)
+        {
+            size_t take = std::min(length, 32 - buffered);
+            memcpy(buffer + buffered, p, take);
+            buffered += take;
+            p += take;
+            length -= take;
+            if (buffered < 32)
+                return;
+            ConsumeStripe(buffer);
+            buffered = 0;
+        }
+        while (length >= 32)
+        {
+            ConsumeStripe(p);
+            p += 32;
+            length -= 32;
+        }
+        memcpy(buffer, p, length);
+        buffered = length;
+    }
+
+    void AddInt(int64_t value)
+    {
+        Update(&value, sizeof(value));
+    }
+    void AddDouble(double value)
+    {
+        Update(&value, sizeof(value));
+    }
+    void AddString(const string &value)
+    {
+        // Length prefix keeps ("ab", "c") and ("a", "bc") distinct
+        AddInt(static_cast<int64_t>(value.size()));
+        Update(value.data(), value.size());
+    }
+    void AddDoubles(const vector<double> &values)
+    {
+        AddInt(static_cast<int64_t>(values.size()));
+        Update(values.data(), values.size() * sizeof(double));
+    }
+
+    uint64_t Digest() const
+    {
+        uint64_t h;
+        if (total_length >= 32)
+        {
+            h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+            h = MergeRound(h, v1);
+            h = MergeRound(h, v2);
+            h = MergeRound(h, v3);
+            h = MergeRound(h, v4);
+        }
+        else
+        {
+            h = seed + Prime5;
+        }
+        h += total_length;
+
+        const unsigned char *p = buffer;
+        size_t remaining = buffered;
+        while (remaining >= 8)
+        {
+            h ^= Round(0, Read64(p));
+            h = Rotl(h, 27) * Prime1 + Prime4;
+            p += 8;
+            remaining -= 8;
+        }
+        if (remaining >= 4)
+        {
+            h ^= static_cast<uint64_t>(Read32(p)) * Prime1;
+            h = Rotl(h, 23) * Prime2 + Prime3;
+            p += 4;
+            remaining -= 4;
+        }
+        while (remaining > 0)
+        {
+            h ^= (*p) * Prime5;
+            h = Rotl(h, 11) * Prime1;
+            p++;
+            remaining--;
+        }
+
+        // Final avalanche
+        h ^= h >> 33;
+        h *= Prime2;
+        h ^= h >> 29;
+        h *= Prime3;
+        h ^= h >> 32;
+        return h;
+    }
+};
+
+// LRU cache of encoded chart images keyed by content hash, bounded by a byte
+// budget, with an optional on-disk tier that survives across processes
+class RenderCache
+{
+private:
+    typedef list<pair<uint64_t, vector<unsigned char>>> EntryList;
+    EntryList entries; // most recently used first
+    unordered_map<uint64_t, EntryList::iterator> index;
+    size_t byte_budget;
+    size_t bytes_used;
+    string disk_directory;
+    size_t hits;
+    size_t misses;
+
+    string DiskPath(uint64_t key) const
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bmp", static_cast<unsigned long long>(key));
+        return disk_directory + "/" + name;
+    }
+
+    void Evict()
+    {
+        while (bytes_used > byte_budget && !entries.empty())
+        {
+            bytes_used -= entries.back().second.size();
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+    void Insert(uint64_t key, const vector<unsigned char> &image)
+    {
+        // Images larger than the whole budget are not worth keeping in memory
+        if (image.size() > byte_budget)
+            return;
+        auto found = index.find(key);
+        if (found != index.end())
+        {
+            bytes_used -= found->second->second.size();
+            entries.erase(found->second);
+        }
+        entries.emplace_front(key, image);
+        index[key] = entries.begin();
+        bytes_used += image.size();
+        Evict();
+    }
+
+    // A file whose size disagrees with its BMP header, e.g. one cut short by
+    // a crash or a full disk, is treated as a miss
+    bool LoadFromDisk(uint64_t key, vector<unsigned char> &image) const
+    {
+        if (disk_directory.empty())
+            return false;
+        ifstream file(DiskPath(key), ios::binary | ios::ate);
+        if (!file)
+            return false;
+        streamsize size = file.tellg();
+        if (size < 14)
+            return false;
+        file.seekg(0);
+        image.resize(static_cast<size_t>(size));
+        if (!file.read(reinterpret_cast<char *>(image.data()), size))
+            return false;
+        uint32_t declared_size = 0;
+        for (int i = 0; i < 4; i++)
+            declared_size |= static_cast<uint32_t>(image[2 + i]) << (8 * i);
+        if (image[0] != 'B' || image[1] != 'M' || declared_size != static_cast<uint64_t>(size))
+        {
+            image.clear();
+            return false;
+        }
+        return true;
+    }
+
+    // Write to a temporary file and rename it into place, so readers never see
+    // a partial image. Keys are content hashes, so if another writer got there
+    // first its file is just as good and ours is dropped.
+    void SaveToDisk(uint64_t key, const vector<unsigned char> &image) const
+    {
+        if (disk_directory.empty())
+            return;
+        string path = DiskPath(key);
+        char suffix[48];
+        snprintf(suffix, sizeof(suffix), ".%llx.%p.tmp",
+                 static_cast<unsigned long long>(chrono::steady_clock::now().time_since_epoch().count()), static_cast<const void *>(this));
+        string temp_path = path + suffix;
+        bool written;
+        {
+            ofstream file(temp_path, ios::binary | ios::trunc);
+            file.write(reinterpret_cast<const char *>(image.data()), image.size());
+            file.close();
+            written = static_cast<bool>(file);
+        }
+        if (!written || rename(temp_path.c_str(), path.c_str()) != 0)
+            remove(temp_path.c_str());
+    }
+
+public:
+    RenderCache(size_t budget_bytes = 64 * 1024 * 1024, string disk_dir = "")
+    {
+        byte_budget = budget_bytes;
+        bytes_used = 0;
+        disk_directory = disk_dir;
+        hits = 0;
+        misses = 0;
+    }
+
+    bool Lookup(uint64_t key, vector<unsigned char> &image)
+    {
+        auto found = index.find(key);
+        if (found != index.end())
+        {
+            // Move to the front of the LRU list
+            entries.splice(entries.begin(), entries, found->second);
+            image = found->second->second;
+            hits++;
+            return true;
+        }
+        if (LoadFromDisk(key, image))
+        {
+            Insert(key, image);
+            hits++;
+            return true;
+        }
+        misses++;
+        return false;
+    }
+
+    void Store(uint64_t key, const vector<unsigned char> &image)
+    {
+        Insert(key, image);
+        SaveToDisk(key, image);
+    }
+
+    void Clear()
+    {
+        entries.clear();
+        index.clear();
+        bytes_used = 0;
+    }
+
+    size_t BytesUsed() const
+    {
+        return bytes_used;
+    }
+    size_t Hits() const
+    {
+        return hits;
+    }
+    size_t Misses() const
+    {
+        return misses;
+    }
+};
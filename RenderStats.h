@@ -0,0 +1,170 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <atomic>
+using namespace std;
+
+// Per-render timings and counters. Only recorded when CPPPLOT_PROFILE is
+// defined; otherwise every PLOT_PROFILE_* macro expands to nothing, the
+// renderers keep no RenderStats at all and callers asking for one get zeroes.
+struct StageTiming
+{
+    const char *name;
+    double start_us;    // offset from the start of the render
+    double duration_us;
+};
+
+// Running totals of heap allocations, read at the start and end of each render.
+// The library cannot see the heap by itself, so a program that counts
+// allocations in a replacement operator new (as bench/alloc_counter.cpp does)
+// installs a reader with SetHeapCounter. Without one the totals stay zero.
+// Allocations made by other threads during a render are counted too.
+struct HeapTotals
+{
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+using HeapCounter = HeapTotals (*)();
+
+inline atomic<HeapCounter> &HeapCounterHook()
+{
+    static atomic<HeapCounter> hook{nullptr};
+    return hook;
+}
+
+inline void SetHeapCounter(HeapCounter counter)
+{
+    HeapCounterHook().store(counter);
+}
+
+inline HeapTotals ReadHeapTotals()
+{
+    HeapCounter counter = HeapCounterHook().load();
+    return counter != nullptr ? counter() : HeapTotals();
+}
+
+struct RenderStats
+{
+    vector<StageTiming> stages;
+    uint64_t points_ingested = 0;
+    uint64_t points_culled = 0;
+    uint64_t points_after_decimation = 0;
+    uint64_t primitives_emitted = 0;
+    // Heap allocations made during the render, as seen by the SetHeapCounter reader
+    uint64_t allocations = 0;
+    uint64_t bytes_allocated = 0;
+    chrono::steady_clock::time_point origin;
+    HeapTotals heap_at_start;
+
+    // Clear everything and start the clock for a new render. stages keeps its
+    // capacity, so timing a render allocates nothing after the first one.
+    void Reset()
+    {
+        stages.clear();
+        points_ingested = 0;
+        points_culled = 0;
+        points_after_decimation = 0;
+        primitives_emitted = 0;
+        allocations = 0;
+        bytes_allocated = 0;
+        heap_at_start = ReadHeapTotals();
+        origin = chrono::steady_clock::now();
+    }
+
+    // Take the heap totals for the render that Reset started
+    void Finish()
+    {
+        HeapTotals now = ReadHeapTotals();
+        allocations = now.allocations - heap_at_start.allocations;
+        bytes_allocated = now.bytes - heap_at_start.bytes;
+    }
+
+    double TotalMicroseconds() const
+    {
+        double total = 0.0;
+        for (const StageTiming &stage : stages)
+        {
+            total += stage.duration_us;
+        }
+        return total;
+    }
+
+    // Chrome trace-event JSON, viewable in chrome://tracing or Perfetto
+    string ToChromeTrace() const
+    {
+        string json = "{\"traceEvents\":[";
+        char event[256];
+        for (size_t i = 0; i < stages.size(); i++)
+        {
+            snprintf(event, sizeof(event), "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                     i == 0 ? "" : ",", stages[i].name, stages[i].start_us, stages[i].duration_us);
+            json += event;
+        }
+        snprintf(event, sizeof(event),
+                 "%s{\"name\":\"RenderStats\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":0,\"args\":{"
+                 "\"points_ingested\":%llu,\"points_culled\":%llu,\"points_after_decimation\":%llu,"
+                 "\"primitives_emitted\":%llu,\"allocations\":%llu,\"bytes_allocated\":%llu}}",
+                 stages.empty() ? "" : ",",
+                 static_cast<unsigned long long>(points_ingested), static_cast<unsigned long long>(points_culled),
+                 static_cast<unsigned long long>(points_after_decimation), static_cast<unsigned long long>(primitives_emitted),
+                 static_cast<unsigned long long>(allocations), static_cast<unsigned long long>(bytes_allocated));
+        json += event;
+        json += "]}";
+        return json;
+    }
+
+    bool WriteChromeTrace(const string &path) const
+    {
+        ofstream file(path, ios::binary | ios::trunc);
+        if (!file)
+            return false;
+        file << ToChromeTrace();
+        return static_cast<bool>(file);
+    }
+};
+
+// Records the wall time of the enclosing scope as one stage of the render
+class ScopedStageTimer
+{
+private:
+    RenderStats &stats;
+    const char *name;
+    chrono::steady_clock::time_point start;
+
+public:
+    ScopedStageTimer(RenderStats &render_stats, const char *stage_name) : stats(render_stats), name(stage_name)
+    {
+        start = chrono::steady_clock::now();
+    }
+    ~ScopedStageTimer()
+    {
+        auto end = chrono::steady_clock::now();
+        double start_us = chrono::duration<double, micro>(start - stats.origin).count();
+        double duration_us = chrono::duration<double, micro>(end - start).count();
+        stats.stages.push_back({name, start_us, duration_us});
+    }
+};
+
+#define PLOT_PROFILE_CONCAT_INNER(a, b) a##b
+#define PLOT_PROFILE_CONCAT(a, b) PLOT_PROFILE_CONCAT_INNER(a, b)
+
+// PLOT_PROFILE_BEGIN and PLOT_PROFILE_END bracket a render; PLOT_PROFILE_REPORT
+// copies the result to a caller's RenderStats pointer, if any (zeroes when
+// profiling is off)
+#ifdef CPPPLOT_PROFILE
+#define PLOT_PROFILE_BEGIN(stats) ((stats).Reset())
+#define PLOT_PROFILE_END(stats) ((stats).Finish())
+#define PLOT_PROFILE_REPORT(stats, out) ((out) != nullptr ? (void)(*(out) = (stats)) : (void)0)
+#define PLOT_PROFILE_SCOPE(stats, name) ScopedStageTimer PLOT_PROFILE_CONCAT(stage_timer_, __LINE__)(stats, name)
+#define PLOT_PROFILE_COUNT(stats, counter, amount) ((stats).counter += (amount))
+#else
+#define PLOT_PROFILE_BEGIN(stats) ((void)0)
+#define PLOT_PROFILE_END(stats) ((void)0)
+#define PLOT_PROFILE_REPORT(stats, out) ((out) != nullptr ? (void)(*(out) = RenderStats()) : (void)0)
+#define PLOT_PROFILE_SCOPE(stats, name) ((void)0)
+#define PLOT_PROFILE_COUNT(stats, counter, amount) ((void)0)
+#endif
@@ -0,0 +1,266 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <limits>
+#include <algorithm>
+#include "RenderCache.h"
+using namespace std;
+
+// Column element types. Int64Time holds epoch nanoseconds and puts the
+// axis it is plotted on into time mode.
+enum class DType
+{
+    Float32,
+    Float64,
+    Int64Time
+};
+
+// Allocator handing out cache-line aligned blocks so column loops can use aligned vector loads
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator
+{
+    typedef T value_type;
+    template <typename U>
+    struct rebind
+    {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(size_t n)
+    {
+        // Round up to whole cache lines so a vector load of the tail stays inside the block
+        size_t bytes = (n * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+        void *p = ::operator new(bytes, std::align_val_t(Alignment));
+        return static_cast<T *>(p);
+    }
+    void deallocate(T *p, size_t)
+    {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const
+    {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const
+    {
+        return false;
+    }
+};
+
+template <typename T>
+using AlignedVector = vector<T, AlignedAllocator<T>>;
+
+// Axis value of a raw column element; timestamps become epoch seconds
+inline double ToAxisValue(float value)
+{
+    return value;
+}
+inline double ToAxisValue(double value)
+{
+    return value;
+}
+inline double ToAxisValue(int64_t epoch_ns)
+{
+    return static_cast<double>(epoch_ns) * 1e-9;
+}
+
+// One contiguous, aligned, typed column of values. Min/max and a content
+// hash are computed once when the column is built, since columns are immutable.
+class Column
+{
+private:
+    DType dtype;
+    size_t count;
+    AlignedVector<unsigned char> bytes;
+    double min_value;
+    double max_value;
+    uint64_t content_hash;
+
+    template <typename T>
+    void Assign(DType type, const T *values, size_t n)
+    {
+        dtype = type;
+        count = n;
+        bytes.resize(n * sizeof(T));
+        if (n > 0)
+            memcpy(bytes.data(), values, n * sizeof(T));
+        Summarise();
+    }
+
+    void Summarise()
+    {
+        min_value = numeric_limits<double>::infinity();
+        max_value = -numeric_limits<double>::infinity();
+        Visit([this](const auto *data, size_t n)
+              {
+                  for (size_t i = 0; i < n; i++)
+                  {
+                      double value = ToAxisValue(data[i]);
+                      min_value = std::min(min_value, value);
+                      max_value = std::max(max_value, value);
+                  } });
+
+        ContentHasher hasher;
+        hasher.AddInt(static_cast<int64_t>(dtype));
+        hasher.AddInt(static_cast<int64_t>(count));
+        hasher.Update(bytes.data(), bytes.size());
+        content_hash = hasher.Digest();
+    }
+
+public:
+    Column()
+    {
+        Assign<double>(DType::Float64, nullptr, 0);
+    }
+    Column(const vector<double> &values)
+    {
+        Assign(DType::Float64, values.data(), values.size());
+    }
+    Column(const vector<float> &values)
+    {
+        Assign(DType::Float32, values.data(), values.size());
+    }
+    static Column Timestamps(const vector<int64_t> &epoch_ns)
+    {
+        Column column;
+        column.Assign(DType::Int64Time, epoch_ns.data(), epoch_ns.size());
+        return column;
+    }
+
+    DType Type() const
+    {
+        return dtype;
+    }
+    size_t Size() const
+    {
+        return count;
+    }
+    size_t Bytes() const
+    {
+        return bytes.size();
+    }
+    double Min() const
+    {
+        return min_value;
+    }
+    double Max() const
+    {
+        return max_value;
+    }
+    uint64_t Hash() const
+    {
+        return content_hash;
+    }
+
+    template <typename T>
+    const T *Data() const
+    {
+        return reinterpret_cast<const T *>(bytes.data());
+    }
+
+    // Call fn(const T *data, size_t n) with the column's real element type,
+    // so loops over the column are compiled once per dtype with no per-element switch
+    template <typename Fn>
+    void Visit(Fn fn) const
+    {
+        switch (dtype)
+        {
+        case DType::Float32:
+            fn(Data<float>(), count);
+            break;
+        case DType::Float64:
+            fn(Data<double>(), count);
+            break;
+        default:
+            fn(Data<int64_t>(), count);
+            break;
+        }
+    }
+
+    double ValueAt(size_t i) const
+    {
+        switch (dtype)
+        {
+        case DType::Float32:
+            return ToAxisValue(Data<float>()[i]);
+        case DType::Float64:
+            return ToAxisValue(Data<double>()[i]);
+        default:
+            return ToAxisValue(Data<int64_t>()[i]);
+        }
+    }
+};
+
+// Map n column values to screen space: origin + (value - lower) / range * extent
+template <typename T>
+void TransformValues(const T *data, size_t n, double lower, double range, double origin, double extent, float *out)
+{
+    const double scale = extent / range;
+    const double offset = origin - lower * scale;
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = static_cast<float>(ToAxisValue(data[i]) * scale + offset);
+    }
+}
+
+inline void TransformColumn(const Column &column, double lower, double range, double origin, double extent, float *out)
+{
+    column.Visit([&](const auto *data, size_t n)
+                 { TransformValues(data, n, lower, range, origin, extent, out); });
+}
+
+// Owns every column of a plot. Series refer to columns by index, so several
+// series can share one x column (e.g. sensors sampled on the same time base).
+class SeriesStore
+{
+private:
+    vector<Column> columns;
+
+public:
+    int Add(Column column)
+    {
+        columns.push_back(std::move(column));
+        return static_cast<int>(columns.size()) - 1;
+    }
+    const Column &operator[](int index) const
+    {
+        return columns[index];
+    }
+    void Replace(int index, Column column)
+    {
+        columns[index] = std::move(column);
+    }
+    size_t Size() const
+    {
+        return columns.size();
+    }
+    size_t Bytes() const
+    {
+        size_t total = 0;
+        for (const Column &column : columns)
+        {
+            total += column.Bytes();
+        }
+        return total;
+    }
+};
+
+// Screen-space scratch for one series at a time. Owned by each plot, or
+// shared by the subplots a Figure worker renders one after another.
+struct RenderScratch
+{
+    AlignedVector<float> screen_x;
+    AlignedVector<float> screen_y;
+    AlignedVector<float> band_lower; // filled bands of derived series
+    AlignedVector<float> band_upper;
+    AlignedVector<uint64_t> occupancy; // one bit per marker position already drawn
+};
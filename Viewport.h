@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+using namespace std;
+
+// Data-space window shown on the plot axes
+struct AxisLimits
+{
+    double x_lower;
+    double x_upper;
+    double y_lower;
+    double y_upper;
+};
+
+// Region of a canvas that the axes map onto, in pixels
+struct PlotArea
+{
+    double left;
+    double top;
+    double right;
+    double bottom;
+};
+
+// The plot area keeps the same proportions at every canvas size: 80..720 x 60..480 on 800x600
+inline PlotArea PlotAreaFor(int canvas_width, int canvas_height)
+{
+    PlotArea area;
+    area.left = 0.1 * canvas_width;
+    area.right = 0.9 * canvas_width;
+    area.top = 0.1 * canvas_height;
+    area.bottom = 0.8 * canvas_height;
+    return area;
+}
+
+// Limits and ticks a Figure computes once for subplots whose axes are linked
+struct SharedAxes
+{
+    bool link_x = false;
+    bool link_y = false;
+    AxisLimits limits = {};
+    vector<double> x_ticks;
+    vector<double> y_ticks;
+};
+
+// Zoom by factor (> 1 zooms in) keeping the data point under (screen_x, screen_y) fixed
+inline AxisLimits ZoomLimits(const AxisLimits &limits, const PlotArea &area, double factor, double screen_x, double screen_y)
+{
+    double fx = (screen_x - area.left) / (area.right - area.left);
+    double fy = (area.bottom - screen_y) / (area.bottom - area.top);
+    double anchor_x = limits.x_lower + fx * (limits.x_upper - limits.x_lower);
+    double anchor_y = limits.y_lower + fy * (limits.y_upper - limits.y_lower);
+
+    AxisLimits zoomed;
+    zoomed.x_lower = anchor_x - (anchor_x - limits.x_lower) / factor;
+    zoomed.x_upper = anchor_x + (limits.x_upper - anchor_x) / factor;
+    zoomed.y_lower = anchor_y - (anchor_y - limits.y_lower) / factor;
+    zoomed.y_upper = anchor_y + (limits.y_upper - anchor_y) / factor;
+    return zoomed;
+}
+
+// Move the window so the content follows a drag of (dx, dy) screen pixels
+inline AxisLimits PanLimits(const AxisLimits &limits, const PlotArea &area, double dx, double dy)
+{
+    double shift_x = -dx / (area.right - area.left) * (limits.x_upper - limits.x_lower);
+    double shift_y = dy / (area.bottom - area.top) * (limits.y_upper - limits.y_lower);
+
+    AxisLimits panned = limits;
+    panned.x_lower += shift_x;
+    panned.x_upper += shift_x;
+    panned.y_lower += shift_y;
+    panned.y_upper += shift_y;
+    return panned;
+}
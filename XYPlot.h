@@ -1,4 +1,11 @@
+#pragma once
+#ifdef _WIN32
+// GDI's min/max macros would break std::min and std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
+#endif
 #include <vector>
 #include <algorithm>
 #include <string>
@@ -8,66 +15,151 @@
 #include <utility>
 #include <cmath>
 #include <set>
-#include <random>
+#include <climits>
+#include "Palette.h"
+#include "RenderCache.h"
+#include "Bitmap.h"
+#include "RenderStats.h"
+#include "SeriesStore.h"
+#include "Viewport.h"
+#include "PlotViewer.h"
+#include "Raster.h"
+#include "Reductions.h"
+#include "Pipeline.h"
 using namespace std;
-struct RGBColor
+#ifdef _WIN32
+// Label fonts, created once per plot or once per Figure and shared by its subplots
+struct PlotFonts
 {
-    int r;
-    int g;
-    int b;
+    HFONT tick_labels;
+    HFONT heading;
+    HFONT axis_labels;
+
+    PlotFonts()
+    {
+        tick_labels = Create(FW_ULTRALIGHT);
+        heading = Create(FW_SEMIBOLD);
+        axis_labels = Create(FW_DEMIBOLD);
+    }
+    PlotFonts(const PlotFonts &) = delete;
+    PlotFonts &operator=(const PlotFonts &) = delete;
+    ~PlotFonts()
+    {
+        DeleteObject(tick_labels);
+        DeleteObject(heading);
+        DeleteObject(axis_labels);
+    }
+    static HFONT Create(int weight)
+    {
+        LOGFONT logFont = {};
+        logFont.lfWeight = weight;
+        return CreateFontIndirect(&logFont);
+    }
 };
+#endif
 struct PlotDetails
 {
     string legend;
-    vector<double> x_coordinates;
-    vector<double> y_coordinates;
+    int x_column; // index into the plot's SeriesStore
+    int y_column;
     int connected;
+    MarkerStyle marker; // scatter series only
+    uint64_t data_hash; // content hash of legend and columns, refreshed by updateColumn
 };
-bool isColorDuplicate(const RGBColor &color, const std::vector<RGBColor> &colors)
+// A statistical summary of one series, drawn as a line over a translucent band
+// in the source's color. Computed on first render and again only when the
+// source's data_hash changes.
+struct DerivedSeries
 {
-    for (const auto &existingColor : colors)
-    {
-        if (existingColor.r == color.r && existingColor.g == color.g && existingColor.b == color.b)
-        {
-            return true;
-        }
-    }
-    return false;
-}
-std::vector<RGBColor> generateRandomColors(int n)
-{
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> distribution(0, 255);
-
-    std::vector<RGBColor> colors;
-
-    while (colors.size() < n)
-    {
-        RGBColor color = {distribution(gen), distribution(gen), distribution(gen)};
-        if (!isColorDuplicate(color, colors))
-        {
-            colors.push_back(color);
-        }
-    }
-
-    return colors;
-}
+    string legend;
+    int source; // index into plots
+    ReductionSpec spec;
+    uint64_t computed_for; // source data_hash of result, 0 before the first render
+    ReducedSeries result;
+};
 class XYPlot
 {
 private:
     string PlotTitle;
     string XLabel;
     string YLabel;
-    vector<PlotDetails *> plots;
+    SeriesStore store;
+    vector<PlotDetails> plots;
+    vector<DerivedSeries> derived;
+    Palette palette;
     vector<RGBColor> plot_colors;
-    vector<double> overall_x_coordinates;
-    vector<double> overall_y_coordinates;
     set<double> unique_x_coordinates;
     set<double> unique_y_coordinates;
     bool LegendDisplay;
     int legendX;
     int legendY;
+    RenderCache *render_cache;
+#ifdef CPPPLOT_PROFILE
+    RenderStats stats; // filled in by each render
+#endif
+    RenderScratch scratch;          // transformed series, reused across series
+    RenderScratch *shared_scratch;  // set by a Figure so subplots reuse one buffer per worker
+    const SharedAxes *shared_axes;  // linked limits and ticks from a Figure
+    bool has_view_limits;     // set while zoomed/panned away from the data bounds
+    AxisLimits view_limits;
+    const atomic<bool> *cancel_flag; // polled between series, and every PipelineChunk points within one
+    RasterMode raster_mode;          // how series are drawn; without GDI everything is software
+    int canvas_width;
+    int canvas_height;
+    PlotArea area; // where the axes sit on the canvas
+#ifdef _WIN32
+    shared_ptr<PlotFonts> fonts;
+#endif
+
+    // Bump whenever the drawing code changes so stale cached images are never reused
+    static constexpr int RenderVersion = 4;
+
+    uint64_t HashSeries(const PlotDetails &p)
+    {
+        ContentHasher hasher;
+        hasher.AddString(p.legend);
+        hasher.AddInt(p.connected);
+        hasher.AddInt(store[p.x_column].Hash());
+        hasher.AddInt(store[p.y_column].Hash());
+        return hasher.Digest();
+    }
+    void InsertUniqueCoordinates(const PlotDetails &p)
+    {
+        // Unique values drive the tick spacing heuristic for line plots
+        store[p.x_column].Visit([this](const auto *data, size_t n)
+                                {
+                                    for (size_t i = 0; i < n; i++)
+                                        unique_x_coordinates.insert(ToAxisValue(data[i])); });
+        store[p.y_column].Visit([this](const auto *data, size_t n)
+                                {
+                                    for (size_t i = 0; i < n; i++)
+                                        unique_y_coordinates.insert(ToAxisValue(data[i])); });
+    }
+    int AddSeries(int x_column, int y_column, string legendstr, int connected)
+    {
+        PlotDetails p;
+        p.x_column = x_column;
+        p.y_column = y_column;
+        p.legend = legendstr;
+        p.connected = connected;
+        p.marker = MarkerStyle::Circle;
+        p.data_hash = HashSeries(p);
+        if (connected)
+            InsertUniqueCoordinates(p);
+        plots.push_back(p);
+        plot_colors.push_back(palette.ColorAt(plot_colors.size()));
+        return static_cast<int>(plots.size()) - 1;
+    }
+    int AddDerived(int series, ReductionSpec spec, string legendstr)
+    {
+        DerivedSeries d;
+        d.legend = legendstr;
+        d.source = series;
+        d.spec = spec;
+        d.computed_for = 0;
+        derived.push_back(d);
+        return static_cast<int>(derived.size()) - 1;
+    }
 
 public:
     XYPlot()
@@ -76,73 +168,142 @@ public:
         XLabel = "";
         YLabel = "";
         LegendDisplay = false;
+        legendX = 0;
+        legendY = 0;
+        render_cache = nullptr;
+        has_view_limits = false;
+        cancel_flag = nullptr;
+        shared_scratch = nullptr;
+        shared_axes = nullptr;
+        SetCanvasSize(800, 600);
+#ifdef _WIN32
+        raster_mode = RasterMode::GDI;
+#else
+        raster_mode = RasterMode::Software;
+#endif
     }
-    void addLinePlot(vector<double> x, vector<double> y, string legendstr = "")
+    // The add*Plot and add*Series calls return the series index used by derived series
+    int addLinePlot(vector<double> x, vector<double> y, string legendstr = "")
     {
-        PlotDetails *p = new (PlotDetails);
-        p->x_coordinates = x;
-        p->y_coordinates = y;
-        for (auto it : x)
-        {
-            overall_x_coordinates.push_back(it);
-            unique_x_coordinates.insert(it);
-        }
-        for (auto it : y)
-        {
-            overall_y_coordinates.push_back(it);
-            unique_y_coordinates.insert(it);
-        }
-        p->legend = legendstr;
-        p->connected = 1;
-        plots.push_back(p);
+        // Separate statements so the x column is always added first
+        int x_column = store.Add(Column(x));
+        int y_column = store.Add(Column(y));
+        return AddSeries(x_column, y_column, legendstr, 1);
+    }
+    int addScatterPlot(vector<double> x, vector<double> y, string legendstr = "")
+    {
+        int x_column = store.Add(Column(x));
+        int y_column = store.Add(Column(y));
+        return AddSeries(x_column, y_column, legendstr, 0);
+    }
+
+    // Columnar API: add a column once, then reference it from any number of
+    // series. Float32 halves memory; timestamp columns give a time axis.
+    int addColumn(const vector<double> &values)
+    {
+        return store.Add(Column(values));
+    }
+    int addColumn(const vector<float> &values)
+    {
+        return store.Add(Column(values));
+    }
+    int addTimeColumn(const vector<int64_t> &epoch_ns)
+    {
+        return store.Add(Column::Timestamps(epoch_ns));
     }
-    void addScatterPlot(vector<double> x, vector<double> y, string legendstr = "")
+    int addLineSeries(int x_column, int y_column, string legendstr = "")
     {
-        PlotDetails *p = new (PlotDetails);
-        p->x_coordinates = x;
-        p->y_coordinates = y;
-        for (auto it : x)
+        return AddSeries(x_column, y_column, legendstr, 1);
+    }
+    int addScatterSeries(int x_column, int y_column, string legendstr = "")
+    {
+        return AddSeries(x_column, y_column, legendstr, 0);
+    }
+
+    // Replace a column's values. Series reading it are rehashed, so cached
+    // images and derived series that depend on it are recomputed on the next render.
+    void updateColumn(int column, Column values)
+    {
+        store.Replace(column, std::move(values));
+        unique_x_coordinates.clear();
+        unique_y_coordinates.clear();
+        for (PlotDetails &p : plots)
         {
-            overall_x_coordinates.push_back(it);
+            if (p.x_column == column || p.y_column == column)
+                p.data_hash = HashSeries(p);
+            if (p.connected)
+                InsertUniqueCoordinates(p);
         }
-        for (auto it : y)
+    }
+
+    // Derived series summarise an existing series without copying it into
+    // another one; they take no part in limits, ticks or the unique sets.
+    // Rolling: mean line over the min..max band of the last window points.
+    int addRollingWindow(int series, size_t window, string legendstr = "")
+    {
+        ReductionSpec spec;
+        spec.kind = ReductionKind::Rolling;
+        spec.window = window;
+        return AddDerived(series, spec, legendstr);
+    }
+    // Median line over a lower..upper quantile band per x bin
+    int addPercentileBand(int series, double lower_quantile = 0.05, double upper_quantile = 0.95, int bins = 200, string legendstr = "")
+    {
+        ReductionSpec spec;
+        spec.kind = ReductionKind::Percentiles;
+        spec.bins = bins;
+        spec.lower_quantile = lower_quantile;
+        spec.upper_quantile = upper_quantile;
+        return AddDerived(series, spec, legendstr);
+    }
+    // Mean line over the min..max band per x bin, a cheap stand-in for millions of points
+    int addEnvelope(int series, int bins = 200, string legendstr = "")
+    {
+        ReductionSpec spec;
+        spec.kind = ReductionKind::Envelope;
+        spec.bins = bins;
+        return AddDerived(series, spec, legendstr);
+    }
+    // Result of a derived series, computing it if the source changed since the last call
+    const ReducedSeries &Reduced(size_t index)
+    {
+        DerivedSeries &d = derived[index];
+        const PlotDetails &p = plots[d.source];
+        if (d.computed_for != p.data_hash)
         {
-            overall_y_coordinates.push_back(it);
+            PLOT_PROFILE_SCOPE(stats, "reduce");
+            Reduce(d.spec, store[p.x_column], store[p.y_column], d.result);
+            d.computed_for = p.data_hash;
         }
-        p->legend = legendstr;
-        p->connected = 0;
-        plots.push_back(p);
+        return d.result;
     }
-    void DrawLine(HDC hdc, int x1, int y1, int x2, int y2, int color)
+    const SeriesStore &Store() const
     {
-        // Set the line color
-        SetDCPenColor(hdc, color);
-
-        // Draw the line
-        MoveToEx(hdc, x1, y1, NULL);
-        LineTo(hdc, x2, y2);
+        return store;
     }
-
-    void DrawColoredLine(HDC hdc, int x1, int y1, int x2, int y2, int r, int g, int b, int linewidth = 1)
+    size_t SeriesCount() const
     {
-        // Create a custom pen with the desired color
-        HPEN hPen = CreatePen(PS_SOLID, linewidth, RGB(r, g, b));
-        HPEN hOldPen = (HPEN)SelectObject(hdc, hPen);
-
-        // Draw the line
-        MoveToEx(hdc, x1, y1, NULL);
-        LineTo(hdc, x2, y2);
-
-        // Clean up: restore the old pen and delete the custom pen
-        SelectObject(hdc, hOldPen);
-        DeleteObject(hPen);
+        return plots.size();
     }
-
-    void DrawText(HDC hdc, int x, int y, const std::string &text)
+    // Columns behind a series, e.g. to pass to updateColumn
+    const PlotDetails &Series(int index) const
     {
-        TextOutA(hdc, x, y, text.c_str(), static_cast<int>(text.length()));
+        return plots[index];
+    }
+    // Number of points in a series; extra values in the longer column are ignored
+    size_t SeriesLength(const PlotDetails &p) const
+    {
+        return std::min(store[p.x_column].Size(), store[p.y_column].Size());
+    }
+    bool TimeAxis() const
+    {
+        for (const PlotDetails &p : plots)
+        {
+            if (store[p.x_column].Type() == DType::Int64Time)
+                return true;
+        }
+        return false;
     }
-
     std::string doubleToString(double value)
     {
         // Use stringstream to format the number
@@ -196,6 +357,608 @@ public:
         return result;
     }
 
+    // Format an epoch-seconds tick as a UTC time of day, or as a date when the axis spans days
+    std::string TimeToString(double epoch_seconds, double span_seconds)
+    {
+        int64_t total = static_cast<int64_t>(std::floor(epoch_seconds));
+        int64_t days = total >= 0 ? total / 86400 : (total - 86399) / 86400;
+        int64_t seconds_of_day = total - days * 86400;
+
+        // Civil date from days since 1970-01-01 (proleptic Gregorian)
+        int64_t z = days + 719468;
+        int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        int64_t doe = z - era * 146097;
+        int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        int64_t mp = (5 * doy + 2) / 153;
+        int64_t day = doy - (153 * mp + 2) / 5 + 1;
+        int64_t month = mp < 10 ? mp + 3 : mp - 9;
+        int64_t year = yoe + era * 400 + (month <= 2);
+
+        char buffer[32];
+        if (span_seconds >= 2 * 86400.0)
+        {
+            snprintf(buffer, sizeof(buffer), "%04lld-%02lld-%02lld", (long long)year, (long long)month, (long long)day);
+        }
+        else
+        {
+            snprintf(buffer, sizeof(buffer), "%02lld:%02lld:%02lld", (long long)(seconds_of_day / 3600),
+                     (long long)(seconds_of_day / 60 % 60), (long long)(seconds_of_day % 60));
+        }
+        return buffer;
+    }
+
+    vector<double> get_coordinates(double lower, double upper)
+    {
+        vector<double> vector_of_int;
+        for (int i = ceil(lower); i <= floor(upper); i++)
+        {
+            vector_of_int.push_back(i);
+        }
+        return vector_of_int;
+    }
+    void SetPlotTitle(string plot_title)
+    {
+        PlotTitle = plot_title;
+    }
+    void SetXLabel(string x_label)
+    {
+        XLabel = x_label;
+    }
+    void SetYLabel(string y_label)
+    {
+        YLabel = y_label;
+    }
+    void SetPalette(Palette plot_palette)
+    {
+        // Series colors are a pure function of the palette and series index
+        palette = plot_palette;
+        plot_colors = palette.Generate(plots.size());
+    }
+    // Marker drawn for each point of a scatter series; Point suits very dense clouds
+    void SetMarkerStyle(int series, MarkerStyle style)
+    {
+        plots[series].marker = style;
+    }
+    // Show the legend with its top-left corner at the given canvas pixel. A
+    // negative coordinate (the default) places it inside the top-right corner
+    // of the plot area instead, so it follows the canvas size.
+    void DisplayLegends(int legendX_coordinate = -1, int legendY_coordinate = -1)
+    {
+        LegendDisplay = true;
+        legendX = legendX_coordinate;
+        legendY = legendY_coordinate;
+    }
+
+    void SetRenderCache(RenderCache *cache)
+    {
+        render_cache = cache;
+    }
+    // Size of the canvas (or Figure panel) the plot is laid out on
+    void SetCanvasSize(int width, int height)
+    {
+        canvas_width = width;
+        canvas_height = height;
+        area = PlotAreaFor(width, height);
+    }
+    int CanvasWidth() const
+    {
+        return canvas_width;
+    }
+    int CanvasHeight() const
+    {
+        return canvas_height;
+    }
+    const PlotArea &Area() const
+    {
+        return area;
+    }
+    void SetSharedAxes(const SharedAxes *axes)
+    {
+        shared_axes = axes;
+    }
+    void SetScratch(RenderScratch *buffers)
+    {
+        shared_scratch = buffers;
+    }
+    RenderScratch &Scratch()
+    {
+        return shared_scratch != nullptr ? *shared_scratch : scratch;
+    }
+    // Number of distinct coordinates on line series, which drives the tick count
+    size_t UniqueXCount() const
+    {
+        return unique_x_coordinates.size();
+    }
+    size_t UniqueYCount() const
+    {
+        return unique_y_coordinates.size();
+    }
+#ifdef _WIN32
+    PlotFonts &Fonts()
+    {
+        if (!fonts)
+            fonts = make_shared<PlotFonts>();
+        return *fonts;
+    }
+    void SetFonts(shared_ptr<PlotFonts> plot_fonts)
+    {
+        fonts = plot_fonts;
+    }
+#endif
+    // Software draws series with anti-aliased lines and markers; axes and text still use GDI
+    void SetRasterMode(RasterMode mode)
+    {
+        raster_mode = mode;
+    }
+
+    // Hash of everything that affects the rendered image: layout, text, series data and colors
+    uint64_t RenderKey()
+    {
+        ContentHasher hasher;
+        hasher.AddString("XYPlot");
+        hasher.AddInt(RenderVersion);
+        hasher.AddInt(canvas_width);
+        hasher.AddInt(canvas_height);
+        hasher.AddString(PlotTitle);
+        hasher.AddString(XLabel);
+        hasher.AddString(YLabel);
+        hasher.AddInt(LegendDisplay);
+        if (LegendDisplay)
+        {
+            hasher.AddInt(legendX);
+            hasher.AddInt(legendY);
+        }
+        hasher.AddInt(static_cast<int>(raster_mode));
+#ifndef _WIN32
+        // Without GDI there is no text, so these images differ from the Windows ones
+        hasher.AddString("software-only");
+#endif
+        hasher.AddInt(has_view_limits);
+        if (has_view_limits)
+        {
+            hasher.AddDouble(view_limits.x_lower);
+            hasher.AddDouble(view_limits.x_upper);
+            hasher.AddDouble(view_limits.y_lower);
+            hasher.AddDouble(view_limits.y_upper);
+        }
+        if (shared_axes != nullptr)
+        {
+            hasher.AddInt(shared_axes->link_x);
+            hasher.AddInt(shared_axes->link_y);
+            if (shared_axes->link_x)
+            {
+                hasher.AddDouble(shared_axes->limits.x_lower);
+                hasher.AddDouble(shared_axes->limits.x_upper);
+                hasher.AddDoubles(shared_axes->x_ticks);
+            }
+            if (shared_axes->link_y)
+            {
+                hasher.AddDouble(shared_axes->limits.y_lower);
+                hasher.AddDouble(shared_axes->limits.y_upper);
+                hasher.AddDoubles(shared_axes->y_ticks);
+            }
+        }
+        hasher.AddInt(plots.size());
+        for (size_t i = 0; i < plots.size(); i++)
+        {
+            hasher.AddInt(plots[i].data_hash);
+            hasher.AddInt(static_cast<int>(plots[i].marker));
+            hasher.AddInt(plot_colors[i].r);
+            hasher.AddInt(plot_colors[i].g);
+            hasher.AddInt(plot_colors[i].b);
+        }
+        // Derived results follow from their source, so the spec is enough
+        hasher.AddInt(derived.size());
+        for (const DerivedSeries &d : derived)
+        {
+            hasher.AddString(d.legend);
+            hasher.AddInt(d.source);
+            hasher.AddInt(static_cast<int>(d.spec.kind));
+            hasher.AddInt(d.spec.window);
+            hasher.AddInt(d.spec.bins);
+            hasher.AddDouble(d.spec.lower_quantile);
+            hasher.AddDouble(d.spec.upper_quantile);
+        }
+        return hasher.Digest();
+    }
+
+    AxisLimits ComputeLimits()
+    {
+        // Each column caches its own min/max, so this is O(series) rather than O(points)
+        double minX = numeric_limits<double>::infinity();
+        double maxX = -numeric_limits<double>::infinity();
+        double minY = numeric_limits<double>::infinity();
+        double maxY = -numeric_limits<double>::infinity();
+        for (const PlotDetails &p : plots)
+        {
+            minX = std::min(minX, store[p.x_column].Min());
+            maxX = std::max(maxX, store[p.x_column].Max());
+            minY = std::min(minY, store[p.y_column].Min());
+            maxY = std::max(maxY, store[p.y_column].Max());
+        }
+
+        double x_range = maxX - minX;
+        double y_range = maxY - minY;
+
+        AxisLimits limits;
+        limits.x_lower = minX - (0.1 * x_range);
+        limits.x_upper = maxX + (0.1 * x_range);
+        limits.y_lower = minY - (0.1 * y_range);
+        limits.y_upper = maxY + (0.1 * y_range);
+        return limits;
+    }
+    // Show a fixed data window instead of the automatic bounds
+    void SetViewLimits(AxisLimits limits)
+    {
+        has_view_limits = true;
+        view_limits = limits;
+    }
+    void ResetViewLimits()
+    {
+        has_view_limits = false;
+    }
+    AxisLimits CurrentLimits()
+    {
+        AxisLimits limits = has_view_limits ? view_limits : ComputeLimits();
+        if (shared_axes != nullptr && shared_axes->link_x)
+        {
+            limits.x_lower = shared_axes->limits.x_lower;
+            limits.x_upper = shared_axes->limits.x_upper;
+        }
+        if (shared_axes != nullptr && shared_axes->link_y)
+        {
+            limits.y_lower = shared_axes->limits.y_lower;
+            limits.y_upper = shared_axes->limits.y_upper;
+        }
+        return limits;
+    }
+    // Ticks for this render, taken from the Figure for linked axes
+    void CurrentTicks(const AxisLimits &limits, vector<double> &x_marked_coordinates, vector<double> &y_marked_coordinates)
+    {
+        if (shared_axes == nullptr || !shared_axes->link_x || !shared_axes->link_y)
+            ComputeTicks(limits, x_marked_coordinates, y_marked_coordinates);
+        if (shared_axes != nullptr && shared_axes->link_x)
+            x_marked_coordinates = shared_axes->x_ticks;
+        if (shared_axes != nullptr && shared_axes->link_y)
+            y_marked_coordinates = shared_axes->y_ticks;
+    }
+    void ComputeTicks(const AxisLimits &limits, vector<double> &x_marked_coordinates, vector<double> &y_marked_coordinates)
+    {
+        double x_lower_lim = limits.x_lower;
+        double x_upper_lim = limits.x_upper;
+        double y_lower_lim = limits.y_lower;
+        double y_upper_lim = limits.y_upper;
+        if (x_upper_lim - x_lower_lim >= 8.0)
+        {
+            vector<double> newx;
+            double interval_size = (x_upper_lim - x_lower_lim) / 8;
+            for (int i = 1; i <= 8 - 1; i++)
+            {
+                newx.push_back(x_lower_lim + i * interval_size);
+            }
+            x_marked_coordinates = newx;
+        }
+        else
+        {
+            x_marked_coordinates = get_coordinates(x_lower_lim, x_upper_lim);
+        }
+        if (y_upper_lim - y_lower_lim >= 8.0)
+        {
+            vector<double> newx;
+            double interval_size = (y_upper_lim - y_lower_lim) / 8;
+            for (int i = 1; i <= 8 - 1; i++)
+            {
+                newx.push_back(y_lower_lim + i * interval_size);
+            }
+            y_marked_coordinates = newx;
+        }
+        else
+        {
+            y_marked_coordinates = get_coordinates(y_lower_lim, y_upper_lim);
+        }
+
+        // if number of marked coordinates is less than n-1 where n is the number of points then uniform divide
+        // (scatter-only plots have no unique coordinates, so n - 1 must not wrap around)
+        if (!unique_x_coordinates.empty() && x_marked_coordinates.size() < unique_x_coordinates.size() - 1)
+        {
+            vector<double> newx;
+            double interval_size = (x_upper_lim - x_lower_lim) / (unique_x_coordinates.size());
+            for (size_t i = 1; i < unique_x_coordinates.size(); i++)
+            {
+                newx.push_back(x_lower_lim + i * interval_size);
+            }
+            x_marked_coordinates = newx;
+        }
+        if (!unique_y_coordinates.empty() && y_marked_coordinates.size() < unique_y_coordinates.size() - 1)
+        {
+            vector<double> newy;
+            double interval_size = (y_upper_lim - y_lower_lim) / (unique_y_coordinates.size());
+            for (size_t i = 1; i < unique_y_coordinates.size(); i++)
+            {
+                newy.push_back(y_lower_lim + i * interval_size);
+            }
+            y_marked_coordinates = newy;
+        }
+    }
+    // Scratch with room for n screen points, as the pipelines expect
+    RenderScratch &ReserveScratch(size_t n)
+    {
+        RenderScratch &buffers = Scratch();
+        if (buffers.screen_x.size() < n)
+        {
+            buffers.screen_x.resize(n);
+            buffers.screen_y.resize(n);
+        }
+        return buffers;
+    }
+    // Transform a derived series: x and center into screen_x/screen_y, the band into band_lower/band_upper
+    void TransformReduced(const ReducedSeries &r, double x_lower_limit, double y_lower_limit, double x_range, double y_range)
+    {
+        RenderScratch &buffers = Scratch();
+        size_t n = r.Size();
+        if (buffers.band_lower.size() < n)
+        {
+            buffers.band_lower.resize(n);
+            buffers.band_upper.resize(n);
+        }
+        if (buffers.screen_x.size() < n)
+        {
+            buffers.screen_x.resize(n);
+            buffers.screen_y.resize(n);
+        }
+        double y_extent = area.top - area.bottom;
+        TransformValues(r.x.data(), n, x_lower_limit, x_range, area.left, area.right - area.left, buffers.screen_x.data());
+        TransformValues(r.center.data(), n, y_lower_limit, y_range, area.bottom, y_extent, buffers.screen_y.data());
+        TransformValues(r.lower.data(), n, y_lower_limit, y_range, area.bottom, y_extent, buffers.band_lower.data());
+        TransformValues(r.upper.data(), n, y_lower_limit, y_range, area.bottom, y_extent, buffers.band_upper.data());
+    }
+    // Legend corner in canvas pixels; 600, 80 on the default 800x600 canvas
+    int LegendLeft() const
+    {
+        return legendX >= 0 ? legendX : static_cast<int>(area.right) - 120;
+    }
+    int LegendTop() const
+    {
+        return legendY >= 0 ? legendY : static_cast<int>(area.top) + 20;
+    }
+    // Map a data value to a screen coordinate inside the plot area
+    double ToScreenX(double value, double x_lower_limit, double x_range)
+    {
+        double x_proportion = (value - x_lower_limit) / x_range;
+        return area.left + x_proportion * (area.right - area.left);
+    }
+    double ToScreenY(double value, double y_lower_limit, double y_range)
+    {
+        double y_proportion = (value - y_lower_limit) / y_range;
+        return area.bottom - y_proportion * (area.bottom - area.top);
+    }
+    // Pixel bounds of the plot area, right and bottom inclusive like the GDI frame
+    int AreaLeft() const
+    {
+        return static_cast<int>(area.left);
+    }
+    int AreaTop() const
+    {
+        return static_cast<int>(area.top);
+    }
+    int AreaRight() const
+    {
+        return static_cast<int>(area.right);
+    }
+    int AreaBottom() const
+    {
+        return static_cast<int>(area.bottom);
+    }
+
+    // Opaque equivalent of a quarter-opacity band over the white background
+    static RGBColor BandTint(RGBColor color)
+    {
+        RGBColor tint;
+        tint.r = 255 - (255 - color.r) * 64 / 255;
+        tint.g = 255 - (255 - color.g) * 64 / 255;
+        tint.b = 255 - (255 - color.b) * 64 / 255;
+        return tint;
+    }
+
+    // Mapping onto the plot area; an interactive render can cancel mid-series
+    PipelineParams SeriesParams(const AxisLimits &limits, RGBColor color) const
+    {
+        PipelineParams params = MakePipelineParams(limits, area, color);
+        params.cancel = cancel_flag;
+        return params;
+    }
+    // Run one series through the pipeline specialized for its kind, column types and marker
+    void RenderSeries(SoftwareRasterizer &raster, const Column &x_column, const Column &y_column, SeriesKind kind, MarkerStyle marker, const PipelineParams &params)
+    {
+        size_t n = std::min(x_column.Size(), y_column.Size());
+        SeriesPipeline pipeline = SelectPipeline(kind, marker, x_column.Type(), y_column.Type());
+        [[maybe_unused]] PipelineCounts counts = pipeline(x_column, y_column, params, raster, ReserveScratch(n));
+        PLOT_PROFILE_COUNT(stats, points_culled, counts.culled);
+        PLOT_PROFILE_COUNT(stats, points_after_decimation, counts.drawn);
+        PLOT_PROFILE_COUNT(stats, primitives_emitted, kind == SeriesKind::Line && counts.drawn > 0 ? counts.drawn - 1 : counts.drawn);
+    }
+    // Anti-aliased counterparts of the GDI drawing calls, usable without a DC
+    void plotcoordinates(SoftwareRasterizer &raster, const Column &x_column, const Column &y_column, double x_lower_limit, double y_lower_limit, double x_range, double y_range, RGBColor color, MarkerStyle marker = MarkerStyle::Circle)
+    {
+        AxisLimits limits = {x_lower_limit, x_lower_limit + x_range, y_lower_limit, y_lower_limit + y_range};
+        RenderSeries(raster, x_column, y_column, SeriesKind::Scatter, marker, SeriesParams(limits, color));
+    }
+    void plotlines(SoftwareRasterizer &raster, const Column &x_column, const Column &y_column, double x_lower_limit, double y_lower_limit, double x_range, double y_range, RGBColor color)
+    {
+        AxisLimits limits = {x_lower_limit, x_lower_limit + x_range, y_lower_limit, y_lower_limit + y_range};
+        RenderSeries(raster, x_column, y_column, SeriesKind::Line, MarkerStyle::Circle, SeriesParams(limits, color));
+    }
+    // Bands go in one coverage pass at quarter opacity, then the center line on top
+    void DrawDerived(SoftwareRasterizer &raster, const AxisLimits &limits)
+    {
+        for (size_t i = 0; i < derived.size(); i++)
+        {
+            if (cancel_flag != nullptr && cancel_flag->load(memory_order_relaxed))
+                break;
+            const ReducedSeries &r = Reduced(i);
+            PLOT_PROFILE_SCOPE(stats, "bands");
+            RenderScratch &buffers = ReserveScratch(r.Size());
+            if (buffers.band_lower.size() < r.Size())
+            {
+                buffers.band_lower.resize(r.Size());
+                buffers.band_upper.resize(r.Size());
+            }
+            PipelineParams params = SeriesParams(limits, plot_colors[derived[i].source]);
+            params.opacity = 64;
+            [[maybe_unused]] PipelineCounts counts = RenderReduced(r, params, 1.5f, raster, buffers);
+            PLOT_PROFILE_COUNT(stats, points_after_decimation, counts.drawn);
+            PLOT_PROFILE_COUNT(stats, primitives_emitted, 2);
+        }
+    }
+    void DrawSeries(SoftwareRasterizer &raster, const AxisLimits &limits)
+    {
+        raster.SetClip(AreaLeft(), AreaTop(), AreaRight() + 1, AreaBottom() + 1);
+        DrawDerived(raster, limits);
+        for (size_t i = 0; i < plots.size(); i++)
+        {
+            if (cancel_flag != nullptr && cancel_flag->load(memory_order_relaxed))
+                break;
+            PLOT_PROFILE_SCOPE(stats, plots[i].connected == 0 ? "markers" : "lines");
+            PLOT_PROFILE_COUNT(stats, points_ingested, SeriesLength(plots[i]));
+            SeriesKind kind = plots[i].connected == 0 ? SeriesKind::Scatter : SeriesKind::Line;
+            RenderSeries(raster, store[plots[i].x_column], store[plots[i].y_column], kind, plots[i].marker, SeriesParams(limits, plot_colors[i]));
+        }
+        raster.ResetClip();
+    }
+    void DrawBoundingBox(SoftwareRasterizer &raster)
+    {
+        RGBColor red = {255, 0, 0};
+        int left = AreaLeft(), top = AreaTop(), right = AreaRight(), bottom = AreaBottom();
+        raster.FillRect(left, top, right, top + 1, red);
+        raster.FillRect(left, bottom, right, bottom + 1, red);
+        raster.FillRect(left, top, left + 1, bottom, red);
+        raster.FillRect(right, top, right + 1, bottom, red);
+    }
+    // Gridlines and tick marks snapped to whole pixels so they stay crisp
+    void DrawGridlines(SoftwareRasterizer &raster, const vector<double> &x_coordinates, const vector<double> &y_coordinates, double x_range, double y_range, double x_lower_limit, double y_lower_limit)
+    {
+        RGBColor grey = {150, 150, 150};
+        RGBColor black = {0, 0, 0};
+        // Ticks are sorted, so dense ticks that land on an already drawn pixel are skipped
+        int left = AreaLeft(), top = AreaTop(), right = AreaRight(), bottom = AreaBottom();
+        int last = INT_MIN;
+        for (auto it : x_coordinates)
+        {
+            int x = static_cast<int>(ToScreenX(it, x_lower_limit, x_range));
+            if (x == last)
+                continue;
+            last = x;
+            raster.FillRect(x, top + 1, x + 1, bottom + 1, grey);
+            raster.FillRect(x, bottom - 5, x + 1, bottom + 5, black);
+        }
+        last = INT_MIN;
+        for (auto it : y_coordinates)
+        {
+            int y = static_cast<int>(ToScreenY(it, y_lower_limit, y_range));
+            if (y == last)
+                continue;
+            last = y;
+            raster.FillRect(left + 1, y, right + 1, y + 1, grey);
+            raster.FillRect(left - 5, y, left + 5, y + 1, black);
+        }
+    }
+    void DrawLegends(SoftwareRasterizer &raster, int legendX, int legendY)
+    {
+        for (size_t i = 0; i < plots.size(); i++)
+        {
+            raster.FillRect(legendX, legendY, legendX + 20, legendY + 20, RGBColor{0, 0, 0});
+            raster.FillRect(legendX + 1, legendY + 1, legendX + 19, legendY + 19, plot_colors[i]);
+            PLOT_PROFILE_COUNT(stats, primitives_emitted, 1);
+            legendY += 25;
+        }
+        for (const DerivedSeries &d : derived)
+        {
+            if (d.legend.empty())
+                continue;
+            raster.FillRect(legendX, legendY, legendX + 20, legendY + 20, RGBColor{0, 0, 0});
+            raster.FillRect(legendX + 1, legendY + 1, legendX + 19, legendY + 19, BandTint(plot_colors[d.source]));
+            PLOT_PROFILE_COUNT(stats, primitives_emitted, 1);
+            legendY += 25;
+        }
+    }
+    // Draw the plot without GDI: frame, gridlines, ticks, anti-aliased series and legend
+    // swatches. Text needs a font rasterizer, so titles and labels only come from RenderTo.
+    void RenderSoftware(FrameBuffer &target)
+    {
+        target.Resize(canvas_width, canvas_height);
+        RenderSoftware(target.Surface());
+    }
+    // Same, into a canvas_width x canvas_height view such as one panel of a Figure
+    void RenderSoftware(PixelSurface target)
+    {
+        PLOT_PROFILE_BEGIN(stats);
+        for (int y = 0; y < target.height; y++)
+        {
+            uint32_t *row = target.pixels + static_cast<size_t>(y) * target.stride;
+            std::fill(row, row + target.width, 0xFFFFFFFFu);
+        }
+        SoftwareRasterizer raster(target);
+        {
+            PLOT_PROFILE_SCOPE(stats, "frame");
+            DrawBoundingBox(raster);
+        }
+        AxisLimits limits;
+        {
+            PLOT_PROFILE_SCOPE(stats, "limits");
+            limits = CurrentLimits();
+        }
+        vector<double> x_marked_coordinates, y_marked_coordinates;
+        {
+            PLOT_PROFILE_SCOPE(stats, "ticks");
+            CurrentTicks(limits, x_marked_coordinates, y_marked_coordinates);
+        }
+        {
+            PLOT_PROFILE_SCOPE(stats, "gridlines");
+            DrawGridlines(raster, x_marked_coordinates, y_marked_coordinates, limits.x_upper - limits.x_lower, limits.y_upper - limits.y_lower, limits.x_lower, limits.y_lower);
+        }
+        DrawSeries(raster, limits);
+        if (LegendDisplay)
+        {
+            PLOT_PROFILE_SCOPE(stats, "legend");
+            DrawLegends(raster, LegendLeft(), LegendTop());
+        }
+        PLOT_PROFILE_END(stats);
+    }
+#ifdef _WIN32
+    void DrawLine(HDC hdc, int x1, int y1, int x2, int y2, int color)
+    {
+        // Set the line color
+        SetDCPenColor(hdc, color);
+
+        // Draw the line
+        MoveToEx(hdc, x1, y1, NULL);
+        LineTo(hdc, x2, y2);
+        PLOT_PROFILE_COUNT(stats, primitives_emitted, 1);
+    }
+
+    void DrawColoredLine(HDC hdc, int x1, int y1, int x2, int y2, int r, int g, int b, int linewidth = 1)
+    {
+        // Create a custom pen with the desired color
+        HPEN hPen = CreatePen(PS_SOLID, linewidth, RGB(r, g, b));
+        HPEN hOldPen = (HPEN)SelectObject(hdc, hPen);
+
+        // Draw the line
+        MoveToEx(hdc, x1, y1, NULL);
+        LineTo(hdc, x2, y2);
+        PLOT_PROFILE_COUNT(stats, primitives_emitted, 1);
+
+        // Clean up: restore the old pen and delete the custom pen
+        SelectObject(hdc, hOldPen);
+        DeleteObject(hPen);
+    }
+
+    void DrawText(HDC hdc, int x, int y, const std::string &text)
+    {
+        TextOutA(hdc, x, y, text.c_str(), static_cast<int>(text.length()));
+        PLOT_PROFILE_COUNT(stats, primitives_emitted, 1);
+    }
+
     void DrawTextWeight(HDC hdc, int x, int y, const std::string &text, int fontWeight)
     {
         // Create a font with the desired font weight
@@ -206,6 +969,7 @@ public:
 
         // Draw the text
         TextOutA(hdc, x, y, text.c_str(), static_cast<int>(text.length()));
+        PLOT_PROFILE_COUNT(stats, primitives_emitted, 1);
 
         // Clean up: restore the old font and delete the custom font
         SelectObject(hdc, hOldFont);
@@ -262,53 +1026,37 @@ public:
 
     void markcoordinates(HDC hdc, vector<double> x_coordinates, vector<double> y_coordinates, double x_range, double y_range, double x_lower_limit, double y_lower_limit)
     {
+        HFONT hOldFont = (HFONT)SelectObject(hdc, Fonts().tick_labels);
         for (auto it : x_coordinates)
         {
-            // x_range: 640
-            // y_range: 480
-            double x_proportion = (it - x_lower_limit) / x_range;
-            double x = 80.0 + x_proportion * 640.0;
-            DrawLine(hdc, x, 480.0 - 5, x, 480.0 + 5, RGB(0, 0, 0));
-            string num = doubleToString(it);
+            double x = ToScreenX(it, x_lower_limit, x_range);
+            DrawLine(hdc, x, area.bottom - 5, x, area.bottom + 5, RGB(0, 0, 0));
+            string num = TimeAxis() ? TimeToString(it, x_range) : doubleToString(it);
             // std::string num = std::to_string(it);
-            LOGFONT logFont = {};
-            logFont.lfWeight = FW_ULTRALIGHT;
-            HFONT hFont = CreateFontIndirect(&logFont);
-            HFONT hOldFont = (HFONT)SelectObject(hdc, hFont);
-            DrawText(hdc, x, 480.0 + 15.0, num);
-            SelectObject(hdc, hOldFont);
-            DeleteObject(hFont);
+            DrawText(hdc, x, area.bottom + 15.0, num);
         }
         for (auto it : y_coordinates)
         {
-            double y_proportion = (it - y_lower_limit) / y_range;
-            double x = 480.0 - y_proportion * 420.0;
-            DrawLine(hdc, 75.0, x, 85.0, x, RGB(0, 0, 0));
+            double x = ToScreenY(it, y_lower_limit, y_range);
+            DrawLine(hdc, area.left - 5, x, area.left + 5, x, RGB(0, 0, 0));
             string num = doubleToString(it);
-            LOGFONT logFont = {};
-            logFont.lfWeight = FW_ULTRALIGHT;
-            HFONT hFont = CreateFontIndirect(&logFont);
-            HFONT hOldFont = (HFONT)SelectObject(hdc, hFont);
-            DrawText(hdc, 50.0, x, num);
-            SelectObject(hdc, hOldFont);
-            DeleteObject(hFont);
+            DrawText(hdc, area.left - 30.0, x, num);
         }
+        SelectObject(hdc, hOldFont);
     }
 
     void DrawGridlines(HDC hdc, vector<double> x_coordinates, vector<double> y_coordinates, double x_range, double y_range, double x_lower_limit, double y_lower_limit)
     {
         for (auto it : x_coordinates)
         {
-            double x_proportion = (it - x_lower_limit) / x_range;
-            double x = 80.0 + x_proportion * 640.0;
-            DrawColoredLine(hdc, x, 480.0, x, 60.0, 150, 150, 150);
+            double x = ToScreenX(it, x_lower_limit, x_range);
+            DrawColoredLine(hdc, x, area.bottom, x, area.top, 150, 150, 150);
             // DrawLine(hdc, x, 480.0, x, 60.0, RGB(255, 0, 0));
         }
         for (auto it : y_coordinates)
         {
-            double y_proportion = (it - y_lower_limit) / y_range;
-            double y = 480.0 - y_proportion * 420.0;
-            DrawColoredLine(hdc, 80.0, y, 720.0, y, 150, 150, 150);
+            double y = ToScreenY(it, y_lower_limit, y_range);
+            DrawColoredLine(hdc, area.left, y, area.right, y, 150, 150, 150);
             // DrawLine(hdc, 80.0, y, 720.0, y, RGB(255, 0, 0));
         }
     }
@@ -318,27 +1066,58 @@ public:
         SelectObject(hdc, hBrush);
         Ellipse(hdc, x - 4, y - 4, x + 4, y + 4);
         DeleteObject(hBrush);
+        PLOT_PROFILE_COUNT(stats, primitives_emitted, 1);
     }
 
-    void plotcoordinates(HDC hdc, vector<double> x_coordinates, vector<double> y_coordinates, double x_lower_limit, double y_lower_limit, double x_range, double y_range, RGBColor color)
+    // One brush for the whole series; positions are culled and deduplicated
+    // exactly as in the software scatter pipeline
+    template <MarkerStyle Marker>
+    void DrawMarkers(HDC hdc, const Column &x_column, const Column &y_column, const PipelineParams &params)
+    {
+        const COLORREF rgb = RGB(params.color.r, params.color.g, params.color.b);
+        const int r = Marker == MarkerStyle::Point ? 0 : params.marker_radius;
+        HBRUSH hBrush = CreateSolidBrush(rgb);
+        HBRUSH hOldBrush = (HBRUSH)SelectObject(hdc, hBrush);
+        PipelineCounts counts;
+        VisitPair(x_column, y_column, [&](const auto *x, const auto *y, size_t n)
+                  { counts = CullMarkers(x, y, n, params, AreaLeft() - r, AreaTop() - r, AreaRight() + 1 + r, AreaBottom() + 1 + r, Scratch().occupancy,
+                                         [hdc, rgb, r](int px, int py)
+                                         {
+                                             if constexpr (Marker == MarkerStyle::Point)
+                                                 SetPixelV(hdc, px, py, rgb);
+                                             else if constexpr (Marker == MarkerStyle::Square)
+                                                 Rectangle(hdc, px - r, py - r, px + r, py + r);
+                                             else
+                                                 Ellipse(hdc, px - r, py - r, px + r, py + r);
+                                         }); });
+        SelectObject(hdc, hOldBrush);
+        DeleteObject(hBrush);
+        PLOT_PROFILE_COUNT(stats, points_culled, counts.culled);
+        PLOT_PROFILE_COUNT(stats, points_after_decimation, counts.drawn);
+        PLOT_PROFILE_COUNT(stats, primitives_emitted, counts.drawn);
+    }
+    void plotcoordinates(HDC hdc, const Column &x_column, const Column &y_column, double x_lower_limit, double y_lower_limit, double x_range, double y_range, RGBColor color, MarkerStyle marker = MarkerStyle::Circle)
     {
-        for (int i = 0; i < x_coordinates.size(); i++)
+        AxisLimits limits = {x_lower_limit, x_lower_limit + x_range, y_lower_limit, y_lower_limit + y_range};
+        PipelineParams params = SeriesParams(limits, color);
+        switch (marker)
         {
-            double x_proportion = (x_coordinates[i] - x_lower_limit) / x_range;
-            double x = 80.0 + x_proportion * 640.0;
-            double y_proportion = (y_coordinates[i] - y_lower_limit) / y_range;
-            double y = 480.0 - y_proportion * 420.0;
-            DrawDot(hdc, x, y, color.r, color.g, color.b);
+        case MarkerStyle::Square:
+            DrawMarkers<MarkerStyle::Square>(hdc, x_column, y_column, params);
+            break;
+        case MarkerStyle::Point:
+            DrawMarkers<MarkerStyle::Point>(hdc, x_column, y_column, params);
+            break;
+        default:
+            DrawMarkers<MarkerStyle::Circle>(hdc, x_column, y_column, params);
+            break;
         }
     }
 
     void AddHeading(HDC hdc, int x, int y, const std::string &text)
     {
         // Get the width and height of the text
-        LOGFONT logFont = {};
-        logFont.lfWeight = FW_SEMIBOLD;
-        HFONT hFont = CreateFontIndirect(&logFont);
-        HFONT hOldFont = (HFONT)SelectObject(hdc, hFont);
+        HFONT hOldFont = (HFONT)SelectObject(hdc, Fonts().heading);
         SIZE textSize;
         GetTextExtentPoint32A(hdc, text.c_str(), static_cast<int>(text.length()), &textSize);
 
@@ -350,17 +1129,14 @@ public:
 
         // Draw the text at the calculated position
         TextOutA(hdc, textX, textY, text.c_str(), static_cast<int>(text.length()));
+        PLOT_PROFILE_COUNT(stats, primitives_emitted, 1);
         SelectObject(hdc, hOldFont);
-        DeleteObject(hFont);
     }
 
     void AddXLabel(HDC hdc, int x, int y, const std::string &text)
     {
         // Get the width and height of the text
-        LOGFONT logFont = {};
-        logFont.lfWeight = FW_DEMIBOLD;
-        HFONT hFont = CreateFontIndirect(&logFont);
-        HFONT hOldFont = (HFONT)SelectObject(hdc, hFont);
+        HFONT hOldFont = (HFONT)SelectObject(hdc, Fonts().axis_labels);
         SIZE textSize;
         GetTextExtentPoint32A(hdc, text.c_str(), static_cast<int>(text.length()), &textSize);
 
@@ -372,8 +1148,8 @@ public:
 
         // Draw the text at the calculated position
         TextOutA(hdc, textX, textY, text.c_str(), static_cast<int>(text.length()));
+        PLOT_PROFILE_COUNT(stats, primitives_emitted, 1);
         SelectObject(hdc, hOldFont);
-        DeleteObject(hFont);
     }
 
     // void AddXLabel(HDC hdc, int centerX, int centerY, const std::string &text)
@@ -406,10 +1182,7 @@ public:
     void AddYLabel(HDC hdc, int x, int y, const std::string &text)
     {
         // Set the graphics mode to advanced
-        LOGFONT logFont = {};
-        logFont.lfWeight = FW_DEMIBOLD;
-        HFONT hFont = CreateFontIndirect(&logFont);
-        HFONT hOldFont = (HFONT)SelectObject(hdc, hFont);
+        HFONT hOldFont = (HFONT)SelectObject(hdc, Fonts().axis_labels);
         SetGraphicsMode(hdc, GM_ADVANCED);
         SIZE textSize;
         GetTextExtentPoint32A(hdc, text.c_str(), static_cast<int>(text.length()), &textSize);
@@ -431,154 +1204,213 @@ public:
 
         // Draw the text
         TextOutA(hdc, 0, 0, text.c_str(), static_cast<int>(text.length()));
+        PLOT_PROFILE_COUNT(stats, primitives_emitted, 1);
 
         // Reset the world transform
         SetWorldTransform(hdc, nullptr);
         SelectObject(hdc, hOldFont);
-        DeleteObject(hFont);
     }
 
-    void plotlines(HDC hdc, vector<double> x_coordinates, vector<double> y_coordinates, double x_lower_limit, double y_lower_limit, double x_range, double y_range, RGBColor color)
+    // GDI strokes and fills are clipped to the plot area grown by a few pixels
+    // before they reach GDI. IntersectClipRect hides the margin, and far
+    // off-screen vertices never overflow LONG or GDI's coordinate range.
+    void GuardRect(float &left, float &top, float &right, float &bottom) const
     {
-        vector<pair<double, double>> points;
-        for (int i = 0; i < x_coordinates.size(); i++)
-        {
-            points.push_back({x_coordinates[i], y_coordinates[i]});
-        }
-        sort(points.begin(), points.end());
-        for (int i = 0; i < points.size() - 1; i++)
-        {
-            double x_proportion = (x_coordinates[i] - x_lower_limit) / x_range;
-            double x1 = 80.0 + x_proportion * 640.0;
-            x_proportion = (x_coordinates[i + 1] - x_lower_limit) / x_range;
-            double x2 = 80.0 + x_proportion * 640.0;
-            double y_proportion = (y_coordinates[i] - y_lower_limit) / y_range;
-            double y1 = 480.0 - y_proportion * 420.0;
-            y_proportion = (y_coordinates[i + 1] - y_lower_limit) / y_range;
-            double y2 = 480.0 - y_proportion * 420.0;
-            DrawColoredLine(hdc, x1, y1, x2, y2, color.r, color.g, color.b, 2);
-            // DrawLine(hdc, x1, y1, x2, y2, RGB(255, 0, 0));
-        }
+        left = AreaLeft() - 4.0f;
+        top = AreaTop() - 4.0f;
+        right = AreaRight() + 5.0f;
+        bottom = AreaBottom() + 5.0f;
     }
-    vector<double> get_coordinates(double lower, double upper)
+    // Stroke the polyline with the selected pen in one Polyline call per
+    // unbroken run, breaking at non-finite points. Returns the call count.
+    int StrokeClipped(HDC hdc, const float *x, const float *y, size_t n, vector<POINT> &points)
     {
-        vector<double> vector_of_int;
-        for (int i = ceil(lower); i <= floor(upper); i++)
+        float left, top, right, bottom;
+        GuardRect(left, top, right, bottom);
+        int polylines = 0;
+        auto flush = [&]()
         {
-            cout << i << " ";
-            vector_of_int.push_back(i);
+            if (points.size() > 1)
+            {
+                Polyline(hdc, points.data(), static_cast<int>(points.size()));
+                polylines++;
+            }
+            points.clear();
+        };
+        points.clear();
+        for (size_t i = 0; i + 1 < n; i++)
+        {
+            double x0 = x[i], y0 = y[i], x1 = x[i + 1], y1 = y[i + 1];
+            bool finite = std::isfinite(x0) && std::isfinite(y0) && std::isfinite(x1) && std::isfinite(y1);
+            if (!finite || !ClipSegmentToRect<double>(x0, y0, x1, y1, left, top, right, bottom))
+            {
+                flush();
+                continue;
+            }
+            POINT start = {static_cast<LONG>(x0), static_cast<LONG>(y0)};
+            POINT end = {static_cast<LONG>(x1), static_cast<LONG>(y1)};
+            // A start clipped away from the previous end begins a new run
+            if (points.empty() || points.back().x != start.x || points.back().y != start.y)
+            {
+                flush();
+                points.push_back(start);
+            }
+            points.push_back(end);
         }
-        cout << endl;
-        return vector_of_int;
-    }
-    void SetPlotTitle(string plot_title)
-    {
-        PlotTitle = plot_title;
+        flush();
+        return polylines;
     }
-    void SetXLabel(string x_label)
-    {
-        XLabel = x_label;
-    }
-    void SetYLabel(string y_label)
+
+    // The decimated polyline goes to GDI in Polyline calls with a single pen,
+    // broken wherever a point has no finite screen position
+    void plotlines(HDC hdc, const Column &x_column, const Column &y_column, double x_lower_limit, double y_lower_limit, double x_range, double y_range, RGBColor color)
     {
-        YLabel = y_label;
+        AxisLimits limits = {x_lower_limit, x_lower_limit + x_range, y_lower_limit, y_lower_limit + y_range};
+        PipelineParams params = SeriesParams(limits, color);
+        RenderScratch &buffers = ReserveScratch(std::min(x_column.Size(), y_column.Size()));
+        PipelineCounts counts;
+        VisitPair(x_column, y_column, [&](const auto *x, const auto *y, size_t n)
+                  { counts = DecimateLine(x, y, n, params, AreaLeft(), AreaRight() + 1, buffers.screen_x.data(), buffers.screen_y.data()); });
+        size_t m = counts.drawn;
+        vector<POINT> points;
+        points.reserve(m);
+        HPEN hPen = CreatePen(PS_SOLID, 2, RGB(color.r, color.g, color.b));
+        HPEN hOldPen = (HPEN)SelectObject(hdc, hPen);
+        [[maybe_unused]] int polylines = StrokeClipped(hdc, buffers.screen_x.data(), buffers.screen_y.data(), m, points);
+        PLOT_PROFILE_COUNT(stats, primitives_emitted, polylines);
+        SelectObject(hdc, hOldPen);
+        DeleteObject(hPen);
+        PLOT_PROFILE_COUNT(stats, points_culled, counts.culled);
+        PLOT_PROFILE_COUNT(stats, points_after_decimation, m);
     }
-    void DrawBoundingBox(HWND hwnd)
+    void DrawBoundingBox(HDC hdc)
     {
-        int X1 = 0.1 * 800;
-        int X2 = 0.9 * 800;
-        int Y1 = 0.1 * 600;
-        int Y2 = 0.8 * 600;
-        DrawLine(GetDC(hwnd), X1, Y1, X2, Y1, RGB(255, 0, 0));
-        DrawLine(GetDC(hwnd), X1, Y2, X2, Y2, RGB(255, 0, 0));
-        DrawLine(GetDC(hwnd), X1, Y1, X1, Y2, RGB(255, 0, 0));
-        DrawLine(GetDC(hwnd), X2, Y1, X2, Y2, RGB(255, 0, 0));
+        int X1 = AreaLeft();
+        int X2 = AreaRight();
+        int Y1 = AreaTop();
+        int Y2 = AreaBottom();
+        DrawLine(hdc, X1, Y1, X2, Y1, RGB(255, 0, 0));
+        DrawLine(hdc, X1, Y2, X2, Y2, RGB(255, 0, 0));
+        DrawLine(hdc, X1, Y1, X1, Y2, RGB(255, 0, 0));
+        DrawLine(hdc, X2, Y1, X2, Y2, RGB(255, 0, 0));
     }
-    void InitialiseCoordinateSpace(HWND hwnd)
+    void InitialiseCoordinateSpace(HDC hdc)
     {
-        double minX = *std::min_element(overall_x_coordinates.begin(), overall_x_coordinates.end());
-        double maxX = *std::max_element(overall_x_coordinates.begin(), overall_x_coordinates.end());
-        double minY = *std::min_element(overall_y_coordinates.begin(), overall_y_coordinates.end());
-        double maxY = *std::max_element(overall_y_coordinates.begin(), overall_y_coordinates.end());
-
-        double x_range = maxX - minX;
-        double y_range = maxY - minY;
-
-        double x_lower_lim = minX - (0.1 * x_range);
-        double x_upper_lim = maxX + (0.1 * x_range);
-        double y_lower_lim = minY - (0.1 * y_range);
-        double y_upper_lim = maxY + (0.1 * y_range);
-        vector<double> x_marked_coordinates, y_marked_coordinates;
-        if (x_upper_lim - x_lower_lim >= 8.0)
+        AxisLimits limits;
         {
-            vector<double> newx;
-            double interval_size = (x_upper_lim - x_lower_lim) / 8;
-            for (int i = 1; i <= 8 - 1; i++)
-            {
-                newx.push_back(x_lower_lim + i * interval_size);
-            }
-            x_marked_coordinates = newx;
+            PLOT_PROFILE_SCOPE(stats, "limits");
+            limits = CurrentLimits();
         }
-        else
+        double x_lower_lim = limits.x_lower;
+        double x_upper_lim = limits.x_upper;
+        double y_lower_lim = limits.y_lower;
+        double y_upper_lim = limits.y_upper;
+        vector<double> x_marked_coordinates, y_marked_coordinates;
         {
-            x_marked_coordinates = get_coordinates(x_lower_lim, x_upper_lim);
+            PLOT_PROFILE_SCOPE(stats, "ticks");
+            CurrentTicks(limits, x_marked_coordinates, y_marked_coordinates);
         }
-        if (y_upper_lim - y_lower_lim >= 8.0)
         {
-            vector<double> newx;
-            double interval_size = (y_upper_lim - y_lower_lim) / 8;
-            for (int i = 1; i <= 8 - 1; i++)
-            {
-                newx.push_back(y_lower_lim + i * interval_size);
-            }
-            y_marked_coordinates = newx;
+            PLOT_PROFILE_SCOPE(stats, "tick_labels");
+            markcoordinates(hdc, x_marked_coordinates, y_marked_coordinates, x_upper_lim - x_lower_lim, y_upper_lim - y_lower_lim, x_lower_lim, y_lower_lim);
         }
-        else
         {
-            y_marked_coordinates = get_coordinates(y_lower_lim, y_upper_lim);
+            PLOT_PROFILE_SCOPE(stats, "gridlines");
+            DrawGridlines(hdc, x_marked_coordinates, y_marked_coordinates, x_upper_lim - x_lower_lim, y_upper_lim - y_lower_lim, x_lower_lim, y_lower_lim);
         }
-
-        // if number of marked coordinates is less than n-1 where n is the number of points then uniform divide
-        if (x_marked_coordinates.size() < unique_x_coordinates.size() - 1)
+        if (raster_mode == RasterMode::Software)
         {
-            vector<double> newx;
-            double interval_size = (x_upper_lim - x_lower_lim) / (unique_x_coordinates.size());
-            for (int i = 1; i <= unique_x_coordinates.size() - 1; i++)
+            // Let GDI finish the gridlines, then rasterize the series straight into the DIB bits
+            GdiFlush();
+            PixelSurface surface = SurfaceFromDC(hdc);
+            if (surface.pixels != nullptr)
             {
-                newx.push_back(x_lower_lim + i * interval_size);
+                SoftwareRasterizer raster(surface);
+                DrawSeries(raster, limits);
+                return;
             }
-            x_marked_coordinates = newx;
         }
-        if (y_marked_coordinates.size() < unique_y_coordinates.size() - 1)
+        // Keep series inside the plot area when zoomed or panned
+        int saved_dc = SaveDC(hdc);
+        IntersectClipRect(hdc, AreaLeft(), AreaTop(), AreaRight() + 1, AreaBottom() + 1);
+        DrawDerived(hdc, limits);
+        for (int i = 0; i < plots.size(); i++)
         {
-            vector<double> newy;
-            double interval_size = (y_upper_lim - y_lower_lim) / (unique_y_coordinates.size());
-            for (int i = 1; i <= unique_y_coordinates.size() - 1; i++)
+            if (cancel_flag != nullptr && cancel_flag->load(memory_order_relaxed))
+                break;
+            PLOT_PROFILE_SCOPE(stats, plots[i].connected == 0 ? "markers" : "lines");
+            PLOT_PROFILE_COUNT(stats, points_ingested, SeriesLength(plots[i]));
+            const Column &x_column = store[plots[i].x_column];
+            const Column &y_column = store[plots[i].y_column];
+            if (plots[i].connected == 0)
             {
-                newy.push_back(y_lower_lim + i * interval_size);
+                plotcoordinates(hdc, x_column, y_column, x_lower_lim, y_lower_lim, x_upper_lim - x_lower_lim, y_upper_lim - y_lower_lim, plot_colors[i], plots[i].marker);
+            }
+            else
+            {
+                plotlines(hdc, x_column, y_column, x_lower_lim, y_lower_lim, x_upper_lim - x_lower_lim, y_upper_lim - y_lower_lim, plot_colors[i]);
             }
-            y_marked_coordinates = newy;
         }
-        markcoordinates(GetDC(hwnd), x_marked_coordinates, y_marked_coordinates, x_upper_lim - x_lower_lim, y_upper_lim - y_lower_lim, x_lower_lim, y_lower_lim);
-        DrawGridlines(GetDC(hwnd), x_marked_coordinates, y_marked_coordinates, x_upper_lim - x_lower_lim, y_upper_lim - y_lower_lim, x_lower_lim, y_lower_lim);
-        plot_colors = generateRandomColors(plots.size());
-        for (int i = 0; i < plots.size(); i++)
+        RestoreDC(hdc, saved_dc);
+    }
+    // GDI has no alpha for polygons, so bands are filled with the tint they would have over white
+    void DrawDerived(HDC hdc, const AxisLimits &limits)
+    {
+        double x_range = limits.x_upper - limits.x_lower;
+        double y_range = limits.y_upper - limits.y_lower;
+        vector<ScreenPoint> band, clipped, clip_scratch;
+        vector<POINT> outline;
+        float left, top, right, bottom;
+        GuardRect(left, top, right, bottom);
+        for (size_t i = 0; i < derived.size(); i++)
         {
-            if (plots[i]->connected == 0)
+            if (cancel_flag != nullptr && cancel_flag->load(memory_order_relaxed))
+                break;
+            const ReducedSeries &r = Reduced(i);
+            PLOT_PROFILE_SCOPE(stats, "bands");
+            size_t n = r.Size();
+            if (n < 2)
+                continue;
+            TransformReduced(r, limits.x_lower, limits.y_lower, x_range, y_range);
+            RenderScratch &buffers = Scratch();
+
+            // Upper edge left to right, then the lower edge back
+            band.resize(2 * n);
+            for (size_t j = 0; j < n; j++)
             {
-                plotcoordinates(GetDC(hwnd), plots[i]->x_coordinates, plots[i]->y_coordinates, x_lower_lim, y_lower_lim, x_upper_lim - x_lower_lim, y_upper_lim - y_lower_lim, plot_colors[i]);
+                band[j] = {buffers.screen_x[j], buffers.band_upper[j]};
+                band[2 * n - 1 - j] = {buffers.screen_x[j], buffers.band_lower[j]};
             }
-            else
+            ClipPolygonToRect(band, left, top, right, bottom, clipped, clip_scratch);
+            outline.resize(clipped.size());
+            for (size_t j = 0; j < clipped.size(); j++)
             {
-                plotlines(GetDC(hwnd), plots[i]->x_coordinates, plots[i]->y_coordinates, x_lower_lim, y_lower_lim, x_upper_lim - x_lower_lim, y_upper_lim - y_lower_lim, plot_colors[i]);
+                outline[j] = {static_cast<LONG>(clipped[j].x), static_cast<LONG>(clipped[j].y)};
             }
+            RGBColor color = plot_colors[derived[i].source];
+            RGBColor tint = BandTint(color);
+            HBRUSH hBrush = CreateSolidBrush(RGB(tint.r, tint.g, tint.b));
+            HBRUSH hOldBrush = (HBRUSH)SelectObject(hdc, hBrush);
+            HPEN hOldPen = (HPEN)SelectObject(hdc, GetStockObject(NULL_PEN));
+            if (outline.size() >= 3)
+                Polygon(hdc, outline.data(), static_cast<int>(outline.size()));
+            SelectObject(hdc, hOldPen);
+            SelectObject(hdc, hOldBrush);
+            DeleteObject(hBrush);
+
+            HPEN hPen = CreatePen(PS_SOLID, 1, RGB(color.r, color.g, color.b));
+            hOldPen = (HPEN)SelectObject(hdc, hPen);
+            StrokeClipped(hdc, buffers.screen_x.data(), buffers.screen_y.data(), n, outline);
+            SelectObject(hdc, hOldPen);
+            DeleteObject(hPen);
+            PLOT_PROFILE_COUNT(stats, primitives_emitted, 2);
         }
     }
-    void SetTextDisplay(HWND hwnd)
+    void SetTextDisplay(HDC hdc)
     {
-        AddHeading(GetDC(hwnd), 400.0, 30.0, PlotTitle);
-        AddYLabel(GetDC(hwnd), 0.0, 300.0, YLabel);
-        AddXLabel(GetDC(hwnd), 400.0, 530.0, XLabel);
+        AddHeading(hdc, canvas_width / 2, area.top / 2, PlotTitle);
+        AddYLabel(hdc, 0.0, canvas_height / 2, YLabel);
+        AddXLabel(hdc, canvas_width / 2, area.bottom + 50.0, XLabel);
     }
     void DrawSquare(HDC hdc, int x, int y, int r, int g, int b)
     {
@@ -591,75 +1423,134 @@ public:
 
         // Draw the square
         Rectangle(hdc, x, y, x + squareSize, y + squareSize);
+        PLOT_PROFILE_COUNT(stats, primitives_emitted, 1);
 
         // Clean up: delete the color brush
         DeleteObject(hBrush);
     }
-    void DrawLegends(HWND hwnd, int legendX = 600, int legendY = 80)
+    void DrawLegends(HDC hdc, int legendX, int legendY)
     {
         for (int i = 0; i < plots.size(); i++)
         {
             // Draw the color dot
-            // DrawDot(GetDC(hwnd), legendX, legendY, plot_colors[i].r, plot_colors[i].g, plot_colors[i].b);
-            DrawSquare(GetDC(hwnd), legendX, legendY, plot_colors[i].r, plot_colors[i].g, plot_colors[i].b);
+            // DrawDot(hdc, legendX, legendY, plot_colors[i].r, plot_colors[i].g, plot_colors[i].b);
+            DrawSquare(hdc, legendX, legendY, plot_colors[i].r, plot_colors[i].g, plot_colors[i].b);
 
             // Draw the identifier name
-            TextOutA(GetDC(hwnd), legendX + 25, legendY, plots[i]->legend.c_str(), static_cast<int>(plots[i]->legend.size()));
+            TextOutA(hdc, legendX + 25, legendY, plots[i].legend.c_str(), static_cast<int>(plots[i].legend.size()));
+            PLOT_PROFILE_COUNT(stats, primitives_emitted, 1);
 
             // Update the legend position for the next entry
             legendY += 25;
         }
+        for (const DerivedSeries &d : derived)
+        {
+            if (d.legend.empty())
+                continue;
+            RGBColor tint = BandTint(plot_colors[d.source]);
+            DrawSquare(hdc, legendX, legendY, tint.r, tint.g, tint.b);
+            TextOutA(hdc, legendX + 25, legendY, d.legend.c_str(), static_cast<int>(d.legend.size()));
+            PLOT_PROFILE_COUNT(stats, primitives_emitted, 1);
+            legendY += 25;
+        }
     }
-    void DisplayLegends(int legendX_coordinate = 600, int legendY_coordinate = 80)
+    // Draw the whole plot
+    void RenderTo(HDC hdc)
     {
-        LegendDisplay = true;
-        legendX = legendX_coordinate;
-        legendY = legendY_coordinate;
+        PLOT_PROFILE_BEGIN(stats);
+        {
+            PLOT_PROFILE_SCOPE(stats, "frame");
+            DrawBoundingBox(hdc);
+        }
+        InitialiseCoordinateSpace(hdc);
+        {
+            PLOT_PROFILE_SCOPE(stats, "text");
+            SetTextDisplay(hdc);
+        }
+        if (LegendDisplay)
+        {
+            PLOT_PROFILE_SCOPE(stats, "legend");
+            DrawLegends(hdc, LegendLeft(), LegendTop());
+        }
+        PLOT_PROFILE_END(stats);
     }
 
+    // Open an interactive window: mouse wheel zooms, left drag pans, right click resets.
+    // Frames are rendered off the UI thread and blitted on WM_PAINT.
     void DisplayPlot()
     {
-        // Register the window class
-        const char CLASS_NAME[] = "Sample Window Class";
-
-        WNDCLASSA wc = {}; // Use WNDCLASSA for narrow character strings
-        wc.lpfnWndProc = DefWindowProc;
-        wc.hInstance = GetModuleHandle(NULL);
-        wc.lpszClassName = CLASS_NAME;
-
-        RegisterClassA(&wc); // Use RegisterClassA for narrow character strings
-
-        // Create the window
-        HWND hwnd = CreateWindowExA(
-            0,
-            CLASS_NAME,
-            "XY Plot Window",
-            WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU,
-            CW_USEDEFAULT, CW_USEDEFAULT, 800, 600,
-            NULL,
-            NULL,
-            GetModuleHandle(NULL),
-            NULL);
+        PlotViewer viewer(canvas_width, canvas_height, ComputeLimits(), [this](const AxisLimits &view, FrameBuffer &target, const atomic<bool> &cancel)
+                          { return RenderView(view, target, cancel); });
+        RunPlotViewerWindow(viewer, "XY Plot Window");
+        ResetViewLimits();
+    }
+#endif
 
-        if (hwnd == NULL)
+    // Render the plot offscreen and return it as a .bmp image. With a render
+    // cache attached, an unchanged plot is returned without drawing anything.
+    // render_stats receives this render's timings and counters when built with
+    // CPPPLOT_PROFILE, and zeroes otherwise.
+    vector<unsigned char> RenderImage(RenderStats *render_stats = nullptr)
+    {
+        vector<unsigned char> image;
+        uint64_t key = 0;
+        if (render_cache != nullptr)
         {
-            return;
+            key = RenderKey();
+            if (render_cache->Lookup(key, image))
+            {
+                if (render_stats != nullptr)
+                    *render_stats = RenderStats();
+                return image;
+            }
         }
+#ifdef _WIN32
+        image = RenderGDIToBMP(canvas_width, canvas_height, [this](HDC hdc)
+                               { RenderTo(hdc); });
+#else
+        FrameBuffer frame;
+        RenderSoftware(frame);
+        image = frame.EncodeBMP();
+#endif
+        PLOT_PROFILE_REPORT(stats, render_stats);
+        if (render_cache != nullptr && !image.empty())
+            render_cache->Store(key, image);
+        return image;
+    }
 
-        ShowWindow(hwnd, SW_SHOW);
+    // Render the given data window into target; called on the viewer's worker thread.
+    // Returns false if cancel was raised before the frame finished.
+    bool RenderView(const AxisLimits &view, FrameBuffer &target, const atomic<bool> &cancel)
+    {
+        SetViewLimits(view);
+        cancel_flag = &cancel;
+#ifdef _WIN32
+        bool rendered = RenderGDIToFrameBuffer(target, canvas_width, canvas_height, [this](HDC hdc)
+                                               { RenderTo(hdc); });
+#else
+        RenderSoftware(target);
+        bool rendered = true;
+#endif
+        cancel_flag = nullptr;
+        return rendered && !cancel.load(memory_order_relaxed);
+    }
 
-        DrawBoundingBox(hwnd);
-        InitialiseCoordinateSpace(hwnd);
-        SetTextDisplay(hwnd);
-        if (LegendDisplay)
-            DrawLegends(hwnd, legendX, legendY);
-        // addLinePlot({1,3,5,4,2},{1,3,5,4,2});
-        //  Message loop
-        MSG msg = {};
-        while (GetMessage(&msg, NULL, 0, 0))
+    // Render into a canvas_width x canvas_height view of a larger buffer, e.g. one Figure panel
+    void RenderPanel(PixelSurface target)
+    {
+#ifdef _WIN32
+        // A DIB can only be selected into one DC at a time, so each panel gets its own
+        FrameBuffer panel;
+        if (!RenderGDIToFrameBuffer(panel, canvas_width, canvas_height, [this](HDC hdc)
+                                    { RenderTo(hdc); }))
+            return;
+        for (int y = 0; y < std::min(target.height, panel.height); y++)
         {
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
+            memcpy(target.pixels + static_cast<size_t>(y) * target.stride, panel.pixels.data() + static_cast<size_t>(y) * panel.width,
+                   std::min(target.width, panel.width) * sizeof(uint32_t));
         }
+#else
+        RenderSoftware(target);
+#endif
     }
 };
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "alloc_counter.h"
+#include "RenderStats.h"
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+std::atomic<uint64_t> g_allocated_bytes{0};
+std::atomic<uint64_t> g_allocation_count{0};
+
+#ifdef CPPPLOT_PROFILE
+// Lets each render report its own allocations in RenderStats
+static HeapTotals ReadAllocationTotals()
+{
+    HeapTotals totals;
+    totals.allocations = g_allocation_count.load(std::memory_order_relaxed);
+    totals.bytes = g_allocated_bytes.load(std::memory_order_relaxed);
+    return totals;
+}
+static const bool heap_counter_installed = (SetHeapCounter(ReadAllocationTotals), true);
+#endif
+
+// MSVC has no std::aligned_alloc and needs the matching _aligned_free
+static void *AlignedMalloc(std::size_t alignment, std::size_t size)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    return std::aligned_alloc(alignment, size);
+#endif
+}
+
+static void AlignedFree(void *p)
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void *operator new(std::size_t size)
+{
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    std::size_t align = static_cast<std::size_t>(alignment);
+    std::size_t rounded = (size + align - 1) / align * align;
+    if (void *p = AlignedMalloc(align, rounded == 0 ? align : rounded))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    AlignedFree(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    AlignedFree(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept
+{
+    AlignedFree(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept
+{
+    AlignedFree(p);
+}
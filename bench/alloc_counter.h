@@ -0,0 +1,56 @@
+#pragma once
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdint>
+
+// Running totals maintained by the replacement operator new in alloc_counter.cpp
+extern std::atomic<uint64_t> g_allocated_bytes;
+extern std::atomic<uint64_t> g_allocation_count;
+
+// Reports heap traffic per iteration for everything allocated while it is alive
+class AllocationCounter
+{
+private:
+    benchmark::State &state;
+    uint64_t start_bytes;
+    uint64_t start_count;
+
+public:
+    explicit AllocationCounter(benchmark::State &bench_state) : state(bench_state)
+    {
+        start_bytes = g_allocated_bytes.load(std::memory_order_relaxed);
+        start_count = g_allocation_count.load(std::memory_order_relaxed);
+    }
+    ~AllocationCounter()
+    {
+        double bytes = static_cast<double>(g_allocated_bytes.load(std::memory_order_relaxed) - start_bytes);
+        double count = static_cast<double>(g_allocation_count.load(std::memory_order_relaxed) - start_count);
+        state.counters["bytes_allocated"] = benchmark::Counter(bytes, benchmark::Counter::kAvgIterations);
+        state.counters["allocations"] = benchmark::Counter(count, benchmark::Counter::kAvgIterations);
+    }
+};
+
+// Reports throughput as points/s given the number of points handled per iteration
+inline void SetPointsProcessed(benchmark::State &state, int64_t points)
+{
+    state.counters["points"] = benchmark::Counter(static_cast<double>(points), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+#ifndef CPPPLOT_BENCH_MAX_N
+#define CPPPLOT_BENCH_MAX_N 100000000
+#endif
+
+// Sweep N from 1e3 up to CPPPLOT_BENCH_MAX_N in powers of ten
+inline void PointSweep(benchmark::internal::Benchmark *b)
+{
+    b->RangeMultiplier(10)->Range(1000, CPPPLOT_BENCH_MAX_N)->Unit(benchmark::kMillisecond);
+}
+
+// Line plots keep their unique coordinates in std::set, roughly 50 bytes of
+// node per point, so 1e8 points would need several GB per benchmark. Their
+// sweep stops at 1e7 however high CPPPLOT_BENCH_MAX_N is set.
+inline void LinePlotSweep(benchmark::internal::Benchmark *b)
+{
+    const int64_t max_n = CPPPLOT_BENCH_MAX_N < 10000000 ? CPPPLOT_BENCH_MAX_N : 10000000;
+    b->RangeMultiplier(10)->Range(1000, max_n)->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,61 @@
+#include "alloc_counter.h"
+#include "Figure.h"
+#include <random>
+
+// Deterministic random walk per panel so every run measures the same data
+static void MakeSparkline(int64_t n, uint64_t seed, vector<double> &x, vector<double> &y)
+{
+    std::mt19937_64 gen(seed);
+    std::normal_distribution<double> step(0.0, 1.0);
+    x.resize(n);
+    y.resize(n);
+    double value = 0.0;
+    for (int64_t i = 0; i < n; i++)
+    {
+        value += step(gen);
+        x[i] = static_cast<double>(i);
+        y[i] = value;
+    }
+}
+
+// 10x10 grid of linked sparklines; compare with one chart of the same point count per panel
+static void BM_FigureSparklines(benchmark::State &state)
+{
+    Figure figure(10, 10);
+    figure.LinkXAxes();
+    for (int row = 0; row < 10; row++)
+    {
+        for (int column = 0; column < 10; column++)
+        {
+            vector<double> x, y;
+            MakeSparkline(state.range(0), row * 10 + column, x, y);
+            figure.Subplot(row, column).addLinePlot(x, y);
+        }
+    }
+    FrameBuffer frame;
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        figure.Render(frame);
+        benchmark::DoNotOptimize(frame.pixels.data());
+    }
+    SetPointsProcessed(state, 100 * state.range(0));
+}
+BENCHMARK(BM_FigureSparklines)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMillisecond);
+
+static void BM_SingleSparkline(benchmark::State &state)
+{
+    Figure figure(1, 1);
+    vector<double> x, y;
+    MakeSparkline(state.range(0), 0, x, y);
+    figure.Subplot(0, 0).addLinePlot(x, y);
+    FrameBuffer frame;
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        figure.Render(frame);
+        benchmark::DoNotOptimize(frame.pixels.data());
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_SingleSparkline)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,26 @@
+#include "alloc_counter.h"
+
+// PieChart draws straight to GDI, so it can only be measured on Windows
+#ifdef _WIN32
+#include "PieChart.h"
+
+static void BM_PieChartDraw(benchmark::State &state)
+{
+    // Sector count sweep; past a few thousand sectors each slice is sub-pixel
+    vector<double> values(state.range(0));
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        values[i] = 1.0 + (i % 7);
+    }
+    PieChart chart;
+    vector<unsigned char> image;
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        image = chart.RenderImage(values);
+        benchmark::DoNotOptimize(image.data());
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_PieChartDraw)->RangeMultiplier(10)->Range(10, 100000)->Unit(benchmark::kMillisecond);
+#endif
@@ -0,0 +1,394 @@
+#include "alloc_counter.h"
+#include "XYPlot.h"
+#include <random>
+#include <type_traits>
+
+// Deterministic random walk so every run measures the same data
+static void MakeSeries(int64_t n, vector<double> &x, vector<double> &y)
+{
+    std::mt19937_64 gen(42);
+    std::normal_distribution<double> step(0.0, 1.0);
+    x.resize(n);
+    y.resize(n);
+    double value = 0.0;
+    for (int64_t i = 0; i < n; i++)
+    {
+        value += step(gen);
+        x[i] = static_cast<double>(i);
+        y[i] = value;
+    }
+}
+
+static void BM_AddLinePlot(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        XYPlot plot;
+        plot.addLinePlot(x, y);
+        benchmark::ClobberMemory();
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_AddLinePlot)->Apply(LinePlotSweep);
+
+static void BM_AddScatterPlot(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        XYPlot plot;
+        plot.addScatterPlot(x, y);
+        benchmark::ClobberMemory();
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_AddScatterPlot)->Apply(PointSweep);
+
+static void BM_ComputeLimits(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    XYPlot plot;
+    plot.addScatterPlot(x, y);
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        AxisLimits limits = plot.ComputeLimits();
+        benchmark::DoNotOptimize(limits);
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_ComputeLimits)->Apply(PointSweep);
+
+static void BM_ComputeTicks(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    XYPlot plot;
+    plot.addLinePlot(x, y);
+    AxisLimits limits = plot.ComputeLimits();
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        vector<double> x_ticks, y_ticks;
+        plot.ComputeTicks(limits, x_ticks, y_ticks);
+        benchmark::DoNotOptimize(x_ticks.data());
+        benchmark::DoNotOptimize(y_ticks.data());
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_ComputeTicks)->Apply(LinePlotSweep);
+
+static void BM_DoubleToString(benchmark::State &state)
+{
+    // Tick labels span tiny, ordinary and large magnitudes
+    vector<double> values;
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> mantissa(-10.0, 10.0);
+    std::uniform_int_distribution<int> exponent(-6, 6);
+    for (int i = 0; i < 1024; i++)
+    {
+        values.push_back(mantissa(gen) * std::pow(10.0, exponent(gen)));
+    }
+    XYPlot plot;
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        for (double value : values)
+        {
+            string label = plot.doubleToString(value);
+            benchmark::DoNotOptimize(label.data());
+        }
+    }
+    SetPointsProcessed(state, values.size());
+}
+BENCHMARK(BM_DoubleToString);
+
+static void BM_ToScreen(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    XYPlot plot;
+    plot.addScatterPlot(x, y);
+    AxisLimits limits = plot.ComputeLimits();
+    double x_range = limits.x_upper - limits.x_lower;
+    double y_range = limits.y_upper - limits.y_lower;
+    vector<double> screen_x(x.size()), screen_y(y.size());
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            screen_x[i] = plot.ToScreenX(x[i], limits.x_lower, x_range);
+            screen_y[i] = plot.ToScreenY(y[i], limits.y_lower, y_range);
+        }
+        benchmark::DoNotOptimize(screen_x.data());
+        benchmark::DoNotOptimize(screen_y.data());
+        benchmark::ClobberMemory();
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_ToScreen)->Apply(PointSweep);
+
+// Bulk column transform, the kernel the draw calls use; compare float32 and float64 storage
+template <typename T>
+static void BM_TransformColumn(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    Column column(vector<T>(y.begin(), y.end()));
+    AlignedVector<float> screen(column.Size());
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        TransformColumn(column, column.Min(), column.Max() - column.Min(), 480.0, -420.0, screen.data());
+        benchmark::DoNotOptimize(screen.data());
+        benchmark::ClobberMemory();
+    }
+    SetPointsProcessed(state, state.range(0));
+    state.SetBytesProcessed(state.iterations() * column.Bytes());
+}
+BENCHMARK_TEMPLATE(BM_TransformColumn, float)->Apply(PointSweep);
+BENCHMARK_TEMPLATE(BM_TransformColumn, double)->Apply(PointSweep);
+
+// Several float32 series sharing one timestamp column
+static void BM_AddSharedTimeSeries(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    vector<int64_t> timestamps(x.size());
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        timestamps[i] = 1700000000000000000LL + static_cast<int64_t>(i) * 1000000;
+    }
+    vector<float> values(y.begin(), y.end());
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        XYPlot plot;
+        int time_column = plot.addTimeColumn(timestamps);
+        for (int series = 0; series < 4; series++)
+        {
+            plot.addScatterSeries(time_column, plot.addColumn(values));
+        }
+        benchmark::ClobberMemory();
+    }
+    SetPointsProcessed(state, 4 * state.range(0));
+}
+BENCHMARK(BM_AddSharedTimeSeries)->Apply(PointSweep);
+
+// Single-pass reductions behind the derived series
+static void BM_RollingWindow(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    Column x_column(x), y_column(y);
+    ReducedSeries result;
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        RollingWindow(x_column, y_column, 1000, result);
+        benchmark::DoNotOptimize(result.center.data());
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_RollingWindow)->Apply(PointSweep);
+
+static void BM_PercentileBand(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    Column x_column(x), y_column(y);
+    ReducedSeries result;
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        PercentileBand(x_column, y_column, 200, 0.05, 0.95, result);
+        benchmark::DoNotOptimize(result.center.data());
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_PercentileBand)->Apply(PointSweep);
+
+static void BM_Envelope(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    Column x_column(x), y_column(y);
+    ReducedSeries result;
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        Envelope(x_column, y_column, 200, result);
+        benchmark::DoNotOptimize(result.center.data());
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_Envelope)->Apply(PointSweep);
+
+// Anti-aliased software path; runs everywhere, compare against BM_RenderLines/BM_RenderMarkers on Windows
+static void BM_RasterLines(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    XYPlot plot;
+    plot.addLinePlot(x, y);
+    AxisLimits limits = plot.ComputeLimits();
+    Column x_column(x), y_column(y);
+    RGBColor color = Palette().ColorAt(0);
+    FrameBuffer frame;
+    frame.Resize(800, 600);
+    SoftwareRasterizer raster(frame.Surface());
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        frame.Clear();
+        plot.plotlines(raster, x_column, y_column, limits.x_lower, limits.y_lower, limits.x_upper - limits.x_lower, limits.y_upper - limits.y_lower, color);
+        benchmark::DoNotOptimize(frame.pixels.data());
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_RasterLines)->Apply(LinePlotSweep);
+
+static void BM_RasterMarkers(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    XYPlot plot;
+    plot.addScatterPlot(x, y);
+    AxisLimits limits = plot.ComputeLimits();
+    Column x_column(x), y_column(y);
+    RGBColor color = Palette().ColorAt(0);
+    FrameBuffer frame;
+    frame.Resize(800, 600);
+    SoftwareRasterizer raster(frame.Surface());
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        frame.Clear();
+        plot.plotcoordinates(raster, x_column, y_column, limits.x_lower, limits.y_lower, limits.x_upper - limits.x_lower, limits.y_upper - limits.y_lower, color);
+        benchmark::DoNotOptimize(frame.pixels.data());
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_RasterMarkers)->Apply(PointSweep);
+
+// Full chart through the software path, the image RenderImage returns without GDI
+static void BM_RenderSoftware(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    XYPlot plot;
+    plot.addLinePlot(x, y);
+    FrameBuffer frame;
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        plot.RenderSoftware(frame);
+        benchmark::DoNotOptimize(frame.pixels.data());
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_RenderSoftware)->Apply(LinePlotSweep);
+
+// Typed columns for the specialized pipelines; int64 stores the values as epoch nanoseconds
+template <typename T>
+static Column MakeColumn(const vector<double> &values)
+{
+    if constexpr (std::is_same_v<T, int64_t>)
+    {
+        vector<int64_t> epoch_ns(values.size());
+        for (size_t i = 0; i < values.size(); i++)
+            epoch_ns[i] = static_cast<int64_t>(values[i] * 1e9);
+        return Column::Timestamps(epoch_ns);
+    }
+    else
+    {
+        return Column(vector<T>(values.begin(), values.end()));
+    }
+}
+
+// One specialized pipeline straight from typed columns, clipped to the plot area.
+// Bytes processed are the column bytes read, to compare with BM_TransformColumn.
+template <SeriesKind Kind, typename T, MarkerStyle Marker>
+static void BM_Pipeline(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    Column x_column = MakeColumn<T>(x), y_column = MakeColumn<T>(y);
+    AxisLimits limits = {x_column.Min(), x_column.Max(), y_column.Min(), y_column.Max()};
+    PlotArea area = PlotAreaFor(800, 600);
+    PipelineParams params = MakePipelineParams(limits, area, Palette().ColorAt(0));
+    SeriesPipeline pipeline = SelectPipeline(Kind, Marker, x_column.Type(), y_column.Type());
+    RenderScratch scratch;
+    scratch.screen_x.resize(x.size());
+    scratch.screen_y.resize(y.size());
+    FrameBuffer frame;
+    frame.Resize(800, 600);
+    SoftwareRasterizer raster(frame.Surface());
+    raster.SetClip(static_cast<int>(area.left), static_cast<int>(area.top), static_cast<int>(area.right) + 1, static_cast<int>(area.bottom) + 1);
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        frame.Clear();
+        PipelineCounts counts = pipeline(x_column, y_column, params, raster, scratch);
+        benchmark::DoNotOptimize(counts);
+        benchmark::DoNotOptimize(frame.pixels.data());
+    }
+    SetPointsProcessed(state, state.range(0));
+    state.SetBytesProcessed(state.iterations() * (x_column.Bytes() + y_column.Bytes()));
+}
+BENCHMARK_TEMPLATE(BM_Pipeline, SeriesKind::Line, float, MarkerStyle::Circle)->Apply(PointSweep);
+BENCHMARK_TEMPLATE(BM_Pipeline, SeriesKind::Line, double, MarkerStyle::Circle)->Apply(PointSweep);
+BENCHMARK_TEMPLATE(BM_Pipeline, SeriesKind::Line, int64_t, MarkerStyle::Circle)->Apply(PointSweep);
+BENCHMARK_TEMPLATE(BM_Pipeline, SeriesKind::Scatter, float, MarkerStyle::Point)->Apply(PointSweep);
+BENCHMARK_TEMPLATE(BM_Pipeline, SeriesKind::Scatter, double, MarkerStyle::Point)->Apply(PointSweep);
+BENCHMARK_TEMPLATE(BM_Pipeline, SeriesKind::Scatter, double, MarkerStyle::Circle)->Apply(PointSweep);
+BENCHMARK_TEMPLATE(BM_Pipeline, SeriesKind::Scatter, double, MarkerStyle::Square)->Apply(PointSweep);
+
+#ifdef _WIN32
+static void BM_RenderLines(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    XYPlot plot;
+    plot.addLinePlot(x, y);
+    AxisLimits limits = plot.ComputeLimits();
+    Column x_column(x), y_column(y);
+    RGBColor color = Palette().ColorAt(0);
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        vector<unsigned char> image = RenderGDIToBMP(800, 600, [&](HDC hdc)
+                                                     { plot.plotlines(hdc, x_column, y_column, limits.x_lower, limits.y_lower, limits.x_upper - limits.x_lower, limits.y_upper - limits.y_lower, color); });
+        benchmark::DoNotOptimize(image.data());
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_RenderLines)->Apply(LinePlotSweep);
+
+static void BM_RenderMarkers(benchmark::State &state)
+{
+    vector<double> x, y;
+    MakeSeries(state.range(0), x, y);
+    XYPlot plot;
+    plot.addScatterPlot(x, y);
+    AxisLimits limits = plot.ComputeLimits();
+    Column x_column(x), y_column(y);
+    RGBColor color = Palette().ColorAt(0);
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        vector<unsigned char> image = RenderGDIToBMP(800, 600, [&](HDC hdc)
+                                                     { plot.plotcoordinates(hdc, x_column, y_column, limits.x_lower, limits.y_lower, limits.x_upper - limits.x_lower, limits.y_upper - limits.y_lower, color); });
+        benchmark::DoNotOptimize(image.data());
+    }
+    SetPointsProcessed(state, state.range(0));
+}
+BENCHMARK(BM_RenderMarkers)->Apply(PointSweep);
+#endif
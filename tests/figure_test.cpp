@@ -0,0 +1,113 @@
+#include "Figure.h"
+#include <gtest/gtest.h>
+
+// A line over [start, start + span) whose height depends on scale
+static void AddRamp(XYPlot &plot, double start, double span, double scale, int points)
+{
+    vector<double> x(points), y(points);
+    for (int i = 0; i < points; i++)
+    {
+        x[i] = start + span * i / points;
+        y[i] = scale * sin(i * 0.1);
+    }
+    plot.addLinePlot(x, y);
+}
+
+TEST(FigureTest, PanelsTileTheCanvas)
+{
+    // A size the grid does not divide evenly
+    Figure figure(3, 4, 803, 601);
+    long long area = 0;
+    for (int row = 0; row < figure.Rows(); row++)
+    {
+        for (int column = 0; column < figure.Columns(); column++)
+        {
+            PanelRect rect = figure.Panel(row, column);
+            EXPECT_GE(rect.left, 0);
+            EXPECT_GE(rect.top, 0);
+            EXPECT_LE(rect.right, figure.Width());
+            EXPECT_LE(rect.bottom, figure.Height());
+            EXPECT_LT(rect.left, rect.right);
+            EXPECT_LT(rect.top, rect.bottom);
+            EXPECT_EQ(figure.Subplot(row, column).CanvasWidth(), rect.right - rect.left);
+            EXPECT_EQ(figure.Subplot(row, column).CanvasHeight(), rect.bottom - rect.top);
+            area += static_cast<long long>(rect.right - rect.left) * (rect.bottom - rect.top);
+
+            for (int other = row * figure.Columns() + column + 1; other < figure.Rows() * figure.Columns(); other++)
+            {
+                PanelRect next = figure.Panel(other / figure.Columns(), other % figure.Columns());
+                bool overlap = rect.left < next.right && next.left < rect.right && rect.top < next.bottom && next.top < rect.bottom;
+                EXPECT_FALSE(overlap) << "panels " << row * figure.Columns() + column << " and " << other;
+            }
+        }
+    }
+    // Disjoint panels covering the whole canvas leave no gaps
+    EXPECT_EQ(area, static_cast<long long>(figure.Width()) * figure.Height());
+}
+
+TEST(FigureTest, LinkedAxesShareLimitsAndTicks)
+{
+    Figure figure(2, 2);
+    figure.LinkXAxes();
+    AddRamp(figure.Subplot(0, 0), 0.0, 10.0, 1.0, 50);
+    AddRamp(figure.Subplot(0, 1), 5.0, 40.0, 3.0, 200);
+    AddRamp(figure.Subplot(1, 0), -20.0, 5.0, 0.5, 80);
+    AddRamp(figure.Subplot(1, 1), 2.0, 8.0, 10.0, 120);
+    // The shared limits are computed when the figure is laid out for a render
+    figure.RenderKey();
+
+    XYPlot &first = figure.Subplot(0, 0);
+    AxisLimits first_limits = first.CurrentLimits();
+    vector<double> first_x_ticks, first_y_ticks;
+    first.CurrentTicks(first_limits, first_x_ticks, first_y_ticks);
+    EXPECT_FALSE(first_x_ticks.empty());
+
+    for (int row = 0; row < 2; row++)
+    {
+        for (int column = 0; column < 2; column++)
+        {
+            XYPlot &plot = figure.Subplot(row, column);
+            AxisLimits limits = plot.CurrentLimits();
+            AxisLimits own = plot.ComputeLimits();
+            EXPECT_DOUBLE_EQ(limits.x_lower, first_limits.x_lower);
+            EXPECT_DOUBLE_EQ(limits.x_upper, first_limits.x_upper);
+            EXPECT_LE(limits.x_lower, own.x_lower);
+            EXPECT_GE(limits.x_upper, own.x_upper);
+            // The unlinked y axis keeps the subplot's own range and ticks
+            EXPECT_DOUBLE_EQ(limits.y_lower, own.y_lower);
+            EXPECT_DOUBLE_EQ(limits.y_upper, own.y_upper);
+
+            vector<double> x_ticks, y_ticks, own_x_ticks, own_y_ticks;
+            plot.CurrentTicks(limits, x_ticks, y_ticks);
+            plot.ComputeTicks(limits, own_x_ticks, own_y_ticks);
+            EXPECT_EQ(x_ticks, first_x_ticks);
+            EXPECT_EQ(y_ticks, own_y_ticks);
+        }
+    }
+}
+
+TEST(FigureTest, UnlinkedPanelsKeepTheirOwnAxes)
+{
+    Figure figure(1, 2);
+    AddRamp(figure.Subplot(0, 0), 0.0, 10.0, 1.0, 50);
+    AddRamp(figure.Subplot(0, 1), 100.0, 400.0, 20.0, 200);
+    figure.RenderKey();
+
+    for (int column = 0; column < 2; column++)
+    {
+        XYPlot &plot = figure.Subplot(0, column);
+        AxisLimits limits = plot.CurrentLimits();
+        AxisLimits own = plot.ComputeLimits();
+        EXPECT_DOUBLE_EQ(limits.x_lower, own.x_lower);
+        EXPECT_DOUBLE_EQ(limits.x_upper, own.x_upper);
+        EXPECT_DOUBLE_EQ(limits.y_lower, own.y_lower);
+        EXPECT_DOUBLE_EQ(limits.y_upper, own.y_upper);
+
+        vector<double> x_ticks, y_ticks, own_x_ticks, own_y_ticks;
+        plot.CurrentTicks(limits, x_ticks, y_ticks);
+        plot.ComputeTicks(own, own_x_ticks, own_y_ticks);
+        EXPECT_EQ(x_ticks, own_x_ticks);
+        EXPECT_EQ(y_ticks, own_y_ticks);
+    }
+    EXPECT_NE(figure.Subplot(0, 0).CurrentLimits().x_upper, figure.Subplot(0, 1).CurrentLimits().x_upper);
+}
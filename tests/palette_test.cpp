@@ -0,0 +1,51 @@
+#include "Palette.h"
+#include <gtest/gtest.h>
+
+static void ExpectSameColor(const RGBColor &a, const RGBColor &b, int i)
+{
+    EXPECT_EQ(a.r, b.r) << "color " << i;
+    EXPECT_EQ(a.g, b.g) << "color " << i;
+    EXPECT_EQ(a.b, b.b) << "color " << i;
+}
+
+// Every kind, with a custom palette short enough that it runs out
+static vector<Palette> AllPalettes()
+{
+    return {Palette(PaletteKind::Tableau10), Palette(PaletteKind::OkabeIto), Palette(PaletteKind::Set2),
+            Palette(PaletteKind::GoldenHSV), Palette(PaletteKind::OKLab),
+            Palette(vector<RGBColor>{{10, 20, 30}, {40, 50, 60}, {70, 80, 90}})};
+}
+
+TEST(PaletteTest, ColorAtMatchesGenerate)
+{
+    for (const Palette &palette : AllPalettes())
+    {
+        // Past the end of every fixed table
+        vector<RGBColor> colors = palette.Generate(40);
+        ASSERT_EQ(colors.size(), 40u);
+        for (int i = 0; i < 40; i++)
+            ExpectSameColor(palette.ColorAt(i), colors[i], i);
+    }
+}
+
+TEST(PaletteTest, ColorsAreDeterministic)
+{
+    vector<Palette> first = AllPalettes(), second = AllPalettes();
+    for (size_t p = 0; p < first.size(); p++)
+    {
+        vector<RGBColor> a = first[p].Generate(40), b = second[p].Generate(40), again = first[p].Generate(40);
+        for (int i = 0; i < 40; i++)
+        {
+            ExpectSameColor(a[i], b[i], i);
+            ExpectSameColor(a[i], again[i], i);
+        }
+    }
+}
+
+TEST(PaletteTest, CustomColorsComeFirst)
+{
+    Palette palette(vector<RGBColor>{{10, 20, 30}, {40, 50, 60}});
+    EXPECT_EQ(palette.Kind(), PaletteKind::Custom);
+    ExpectSameColor(palette.ColorAt(0), {10, 20, 30}, 0);
+    ExpectSameColor(palette.ColorAt(1), {40, 50, 60}, 1);
+}
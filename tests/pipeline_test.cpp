@@ -0,0 +1,143 @@
+#include "Pipeline.h"
+#include <gtest/gtest.h>
+
+// A sine wave sampled n times across [0, 1] x [-1, 1]
+static void MakeWave(size_t n, vector<double> &x, vector<double> &y)
+{
+    x.resize(n);
+    y.resize(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        x[i] = static_cast<double>(i) / (n - 1);
+        y[i] = sin(x[i] * 40.0);
+    }
+}
+
+class PipelineTest : public ::testing::Test
+{
+protected:
+    FrameBuffer frame;
+    RenderScratch scratch;
+    PlotArea area = PlotAreaFor(800, 600);
+
+    void SetUp() override
+    {
+        frame.Resize(800, 600);
+        frame.Clear();
+    }
+    PipelineCounts Run(SeriesKind kind, const Column &x, const Column &y, const AxisLimits &limits, const atomic<bool> *cancel = nullptr)
+    {
+        scratch.screen_x.resize(x.Size());
+        scratch.screen_y.resize(x.Size());
+        SoftwareRasterizer raster(frame.Surface());
+        raster.SetClip(static_cast<int>(area.left), static_cast<int>(area.top), static_cast<int>(area.right) + 1, static_cast<int>(area.bottom) + 1);
+        PipelineParams params = MakePipelineParams(limits, area, RGBColor{31, 119, 180});
+        params.cancel = cancel;
+        return SelectPipeline(kind, MarkerStyle::Circle, x.Type(), y.Type())(x, y, params, raster, scratch);
+    }
+    size_t PaintedPixels() const
+    {
+        size_t painted = 0;
+        for (uint32_t pixel : frame.pixels)
+            painted += pixel != 0xFFFFFFFFu;
+        return painted;
+    }
+};
+
+TEST_F(PipelineTest, CancelStopsLongSeriesMidway)
+{
+    vector<double> x, y;
+    MakeWave(4 * PipelineChunk, x, y);
+    Column x_column(x), y_column(y);
+    AxisLimits limits = {0.0, 1.0, -1.0, 1.0};
+
+    atomic<bool> cancel{true};
+    PipelineCounts lines = Run(SeriesKind::Line, x_column, y_column, limits, &cancel);
+    PipelineCounts markers = Run(SeriesKind::Scatter, x_column, y_column, limits, &cancel);
+    EXPECT_LT(lines.drawn, PipelineChunk);
+    EXPECT_EQ(markers.drawn + markers.culled, 0u);
+    EXPECT_EQ(PaintedPixels(), 0u);
+
+    cancel = false;
+    lines = Run(SeriesKind::Line, x_column, y_column, limits, &cancel);
+    EXPECT_GT(lines.drawn, 0u);
+    EXPECT_GT(PaintedPixels(), 0u);
+}
+
+TEST_F(PipelineTest, LinePointsOutsideClipAreCulled)
+{
+    vector<double> x, y;
+    MakeWave(10000, x, y);
+    Column x_column(x), y_column(y);
+
+    PipelineCounts inside = Run(SeriesKind::Line, x_column, y_column, {0.0, 1.0, -1.0, 1.0});
+    EXPECT_EQ(inside.culled, 0u);
+
+    // Zoomed into the middle half, about a quarter of the points lie off each side
+    PipelineCounts zoomed = Run(SeriesKind::Line, x_column, y_column, {0.25, 0.75, -1.0, 1.0});
+    EXPECT_GT(zoomed.culled, 4500u);
+    EXPECT_LE(zoomed.culled + zoomed.drawn, 10000u);
+}
+
+TEST_F(PipelineTest, NaNInsideColumnRunBreaksTheLine)
+{
+    // Ten points in one pixel column with a gap in the middle
+    vector<double> x(10, 0.5), y = {0.1, 0.4, -0.3, 0.2, 0.0, NAN, 0.3, -0.5, 0.6, 0.1};
+    PipelineParams params = MakePipelineParams({0.0, 1.0, -1.0, 1.0}, area, RGBColor{0, 0, 0});
+    vector<float> out_x(x.size()), out_y(x.size());
+    PipelineCounts counts = DecimateLine(x.data(), y.data(), x.size(), params, static_cast<int>(area.left), static_cast<int>(area.right) + 1, out_x.data(), out_y.data());
+
+    // Each side of the gap keeps its own first, last and extremes, with one break between
+    vector<size_t> breaks;
+    for (size_t i = 0; i < counts.drawn; i++)
+    {
+        if (std::isnan(out_x[i]))
+            breaks.push_back(i);
+    }
+    ASSERT_EQ(breaks.size(), 1u);
+    EXPECT_EQ(breaks[0], 4u);
+    EXPECT_EQ(counts.drawn, 9u);
+    EXPECT_EQ(counts.culled, 1u);
+    EXPECT_FLOAT_EQ(out_y[3], static_cast<float>(0.0 * params.y_scale + params.y_offset));
+    EXPECT_FLOAT_EQ(out_y[5], static_cast<float>(0.3 * params.y_scale + params.y_offset));
+}
+
+TEST_F(PipelineTest, LongColumnRunKeepsLateExtremesAndGaps)
+{
+    // Long enough that most of each run goes through the whole-block test
+    vector<double> x(128, 0.5), y(128, 0.0);
+    y[20] = -0.2;
+    y[50] = 0.9;
+    y[70] = NAN;
+    y[90] = -0.9;
+    y[100] = 0.3;
+    PipelineParams params = MakePipelineParams({0.0, 1.0, -1.0, 1.0}, area, RGBColor{0, 0, 0});
+    vector<float> out_x(x.size()), out_y(x.size());
+    PipelineCounts counts = DecimateLine(x.data(), y.data(), x.size(), params, static_cast<int>(area.left), static_cast<int>(area.right) + 1, out_x.data(), out_y.data());
+
+    ASSERT_EQ(counts.drawn, 9u);
+    EXPECT_EQ(counts.culled, 1u);
+    EXPECT_TRUE(std::isnan(out_x[4]));
+    const double expected[] = {0.0, -0.2, 0.9, 0.0, 0.0, 0.0, -0.9, 0.3, 0.0};
+    for (size_t i = 0; i < 9; i++)
+    {
+        if (i != 4)
+            EXPECT_FLOAT_EQ(out_y[i], static_cast<float>(expected[i] * params.y_scale + params.y_offset)) << i;
+    }
+}
+
+TEST_F(PipelineTest, DenseMarkersDrawEachPositionOnce)
+{
+    // Four positions repeated many times, every fifth point missing
+    const double positions[] = {0.2, 0.4, 0.6, 0.8, NAN};
+    vector<double> x(1000), y(1000);
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        x[i] = positions[i % 5];
+        y[i] = std::isnan(x[i]) ? 0.0 : x[i] - 0.5;
+    }
+    Column x_column(x), y_column(y);
+    PipelineCounts counts = Run(SeriesKind::Scatter, x_column, y_column, {0.0, 1.0, -1.0, 1.0});
+    EXPECT_EQ(counts.drawn, 4u);
+    EXPECT_EQ(counts.culled, 200u);
+}
@@ -0,0 +1,171 @@
+#include "PlotViewer.h"
+#include <gtest/gtest.h>
+#include <cstring>
+
+// Render callback whose frames block until the test opens the gate, so the
+// worker is reliably busy while events arrive. Each frame records the view it
+// was rendered for in its first pixels.
+class GatedRenderer
+{
+private:
+    mutex gate_mutex;
+    condition_variable gate_changed;
+    bool open = false;
+    int started = 0;
+
+public:
+    bool Render(const AxisLimits &view, FrameBuffer &target, const atomic<bool> &cancel)
+    {
+        {
+            unique_lock<mutex> lock(gate_mutex);
+            started++;
+            gate_changed.notify_all();
+            gate_changed.wait(lock, [this]
+                              { return open; });
+        }
+        if (cancel.load(memory_order_relaxed))
+            return false;
+        target.Resize(4, 4);
+        target.Clear();
+        memcpy(target.pixels.data(), &view, sizeof(view));
+        return true;
+    }
+    void WaitForStart(int count)
+    {
+        unique_lock<mutex> lock(gate_mutex);
+        gate_changed.wait(lock, [this, count]
+                          { return started >= count; });
+    }
+    void Open()
+    {
+        lock_guard<mutex> lock(gate_mutex);
+        open = true;
+        gate_changed.notify_all();
+    }
+    PlotViewer::RenderFn Fn()
+    {
+        return [this](const AxisLimits &view, FrameBuffer &target, const atomic<bool> &cancel)
+        { return Render(view, target, cancel); };
+    }
+};
+
+static AxisLimits FrameView(const FrameBuffer &frame)
+{
+    AxisLimits view;
+    memcpy(&view, frame.pixels.data(), sizeof(view));
+    return view;
+}
+
+static const AxisLimits InitialView = {0.0, 10.0, 0.0, 10.0};
+
+// Start a viewer, begin one frame for the initial view and queue pan and zoom
+// input while that frame is still blocked in the renderer
+static void DriveWhileBusy(PlotViewer &viewer, GatedRenderer &renderer)
+{
+    viewer.Start();
+    viewer.RequestRender();
+    renderer.WaitForStart(1);
+
+    FakeEventSource events;
+    for (int i = 0; i < 8; i++)
+        events.PushPan(5.0, -3.0);
+    events.PushZoom(1.25, 400.0, 300.0);
+    events.PushZoom(1.25, 400.0, 300.0);
+    viewer.Run(events, [](const FrameBuffer &) {});
+}
+
+TEST(PlotViewerTest, CoalescesInputWhileRendering)
+{
+    GatedRenderer renderer;
+    PlotViewer viewer(800, 600, InitialView, renderer.Fn());
+    DriveWhileBusy(viewer, renderer);
+
+    // The first event becomes the pending request; the other nine replace it
+    EXPECT_EQ(viewer.RequestsCoalesced(), 9u);
+    renderer.Open();
+    ASSERT_TRUE(viewer.WaitForIdle());
+    // One frame for all ten events, not one per event
+    EXPECT_EQ(viewer.FramesRendered(), 1u);
+}
+
+TEST(PlotViewerTest, CancelsStaleFrame)
+{
+    GatedRenderer renderer;
+    PlotViewer viewer(800, 600, InitialView, renderer.Fn());
+    DriveWhileBusy(viewer, renderer);
+
+    renderer.Open();
+    ASSERT_TRUE(viewer.WaitForIdle());
+    // The initial view was superseded while rendering and never presented
+    EXPECT_EQ(viewer.FramesCancelled(), 1u);
+    EXPECT_EQ(viewer.FramesRendered(), 1u);
+}
+
+TEST(PlotViewerTest, WaitForIdlePresentsLatestView)
+{
+    GatedRenderer renderer;
+    PlotViewer viewer(800, 600, InitialView, renderer.Fn());
+    DriveWhileBusy(viewer, renderer);
+
+    // Apply the same input without the viewer to get the expected final view
+    PlotArea area = PlotAreaFor(800, 600);
+    AxisLimits expected = InitialView;
+    for (int i = 0; i < 8; i++)
+        expected = PanLimits(expected, area, 5.0, -3.0);
+    expected = ZoomLimits(expected, area, 1.25, 400.0, 300.0);
+    expected = ZoomLimits(expected, area, 1.25, 400.0, 300.0);
+
+    renderer.Open();
+    ASSERT_TRUE(viewer.WaitForIdle());
+    AxisLimits presented = {};
+    ASSERT_TRUE(viewer.Present([&presented](const FrameBuffer &frame)
+                               { presented = FrameView(frame); }));
+    EXPECT_DOUBLE_EQ(presented.x_lower, expected.x_lower);
+    EXPECT_DOUBLE_EQ(presented.x_upper, expected.x_upper);
+    EXPECT_DOUBLE_EQ(presented.y_lower, expected.y_lower);
+    EXPECT_DOUBLE_EQ(presented.y_upper, expected.y_upper);
+}
+
+TEST(PlotViewerTest, DragStateIsPerViewer)
+{
+    GatedRenderer renderer;
+    PlotViewer first(800, 600, InitialView, renderer.Fn());
+    PlotViewer second(800, 600, InitialView, renderer.Fn());
+
+    ViewEvent event{ViewEvent::Paint};
+    first.BeginDrag(100.0, 100.0);
+    // A move over a window that is not dragging must not pan it
+    EXPECT_FALSE(second.DragTo(300.0, 50.0, event));
+    second.BeginDrag(300.0, 50.0);
+
+    ASSERT_TRUE(first.DragTo(110.0, 95.0, event));
+    EXPECT_EQ(event.kind, ViewEvent::Pan);
+    EXPECT_DOUBLE_EQ(event.x, 10.0);
+    EXPECT_DOUBLE_EQ(event.y, -5.0);
+
+    first.EndDrag();
+    EXPECT_FALSE(first.DragTo(120.0, 90.0, event));
+    ASSERT_TRUE(second.DragTo(302.0, 53.0, event));
+    EXPECT_DOUBLE_EQ(event.x, 2.0);
+    EXPECT_DOUBLE_EQ(event.y, 3.0);
+}
+
+TEST(PlotViewerTest, RestartsAfterStop)
+{
+    GatedRenderer renderer;
+    renderer.Open();
+    PlotViewer viewer(800, 600, InitialView, renderer.Fn());
+
+    viewer.Start();
+    viewer.RequestRender();
+    ASSERT_TRUE(viewer.WaitForIdle());
+    EXPECT_EQ(viewer.FramesRendered(), 1u);
+    viewer.Stop();
+
+    // A restarted worker must render again rather than see the old stop
+    viewer.Start();
+    viewer.RequestPan(5.0, 0.0);
+    ASSERT_TRUE(viewer.WaitForIdle());
+    EXPECT_EQ(viewer.FramesRendered(), 2u);
+    viewer.Stop();
+}
@@ -0,0 +1,96 @@
+#include "Raster.h"
+#include <gtest/gtest.h>
+#include <random>
+
+TEST(ClipTest, SegmentFarOutsideIsClippedToRect)
+{
+    // A vertex far beyond LONG's range, as a deep zoom produces
+    double x0 = 100.0, y0 = 100.0, x1 = 300.0, y1 = 1e12;
+    ASSERT_TRUE(ClipSegmentToRect(x0, y0, x1, y1, 0.0, 0.0, 800.0, 600.0));
+    EXPECT_DOUBLE_EQ(x0, 100.0);
+    EXPECT_DOUBLE_EQ(y0, 100.0);
+    EXPECT_NEAR(x1, 100.0, 1e-6);
+    EXPECT_DOUBLE_EQ(y1, 600.0);
+
+    float a = -1e12f, b = -5.0f, c = 1e12f, d = -5.0f;
+    EXPECT_FALSE(ClipSegmentToRect(a, b, c, d, 0.0f, 0.0f, 800.0f, 600.0f));
+}
+
+TEST(ClipTest, PolygonStaysInsideRect)
+{
+    vector<ScreenPoint> polygon = {{-1e9f, 100.0f}, {1e9f, 100.0f}, {1e9f, 1e9f}, {-1e9f, 1e9f}};
+    vector<ScreenPoint> clipped, scratch;
+    ClipPolygonToRect(polygon, 0.0f, 0.0f, 800.0f, 600.0f, clipped, scratch);
+    ASSERT_EQ(clipped.size(), 4u);
+    for (const ScreenPoint &p : clipped)
+    {
+        EXPECT_GE(p.x, 0.0f);
+        EXPECT_LE(p.x, 800.0f);
+        EXPECT_GE(p.y, 100.0f);
+        EXPECT_LE(p.y, 600.0f);
+    }
+
+    vector<ScreenPoint> outside = {{-30.0f, -30.0f}, {-10.0f, -30.0f}, {-10.0f, -10.0f}};
+    ClipPolygonToRect(outside, 0.0f, 0.0f, 800.0f, 600.0f, clipped, scratch);
+    EXPECT_TRUE(clipped.empty());
+}
+
+// Random destination pixels, with a fixed seed so failures reproduce
+static vector<uint32_t> RandomPixels(mt19937 &rng, int n)
+{
+    vector<uint32_t> pixels(n);
+    for (uint32_t &p : pixels)
+        p = static_cast<uint32_t>(rng());
+    return pixels;
+}
+
+// A single pixel never fills a SIMD block, so blending pixel by pixel runs
+// only the scalar loop; whole spans must match it for every tail length
+TEST(BlendTest, CoverageSpanMatchesScalar)
+{
+    mt19937 rng(7);
+    for (int n = 0; n <= 40; n++)
+    {
+        vector<uint8_t> coverage(n);
+        for (int i = 0; i < n; i++)
+        {
+            // The second 16-pixel block is empty to take the skip path
+            if (i / 16 == 1)
+                coverage[i] = 0;
+            else
+                coverage[i] = rng() % 4 == 0 ? 255 : static_cast<uint8_t>(rng());
+        }
+        uint32_t color = static_cast<uint32_t>(rng());
+        vector<uint32_t> span = RandomPixels(rng, n);
+        vector<uint32_t> scalar = span;
+
+        BlendCoverageSpan(span.data(), coverage.data(), n, color);
+        for (int i = 0; i < n; i++)
+            BlendCoverageSpan(&scalar[i], &coverage[i], 1, color);
+        EXPECT_EQ(span, scalar) << "n = " << n;
+    }
+}
+
+TEST(BlendTest, PremultipliedSpanMatchesScalar)
+{
+    mt19937 rng(11);
+    for (int n = 0; n <= 40; n++)
+    {
+        // Premultiplied sources: no channel exceeds alpha, transparent is all zero
+        vector<uint32_t> src(n);
+        for (uint32_t &p : src)
+        {
+            uint32_t alpha = rng() % 4 == 0 ? 0 : rng() % 3 == 0 ? 255 : rng() % 256;
+            p = alpha << 24;
+            for (int shift = 0; shift < 24; shift += 8)
+                p |= (alpha == 0 ? 0 : rng() % (alpha + 1)) << shift;
+        }
+        vector<uint32_t> span = RandomPixels(rng, n);
+        vector<uint32_t> scalar = span;
+
+        BlendPremultipliedSpan(span.data(), src.data(), n);
+        for (int i = 0; i < n; i++)
+            BlendPremultipliedSpan(&scalar[i], &src[i], 1);
+        EXPECT_EQ(span, scalar) << "n = " << n;
+    }
+}
@@ -0,0 +1,52 @@
+#include "Reductions.h"
+#include <gtest/gtest.h>
+
+static const double NaN = numeric_limits<double>::quiet_NaN();
+static const double Inf = numeric_limits<double>::infinity();
+
+static void ExpectAllFinite(const ReducedSeries &r)
+{
+    for (size_t i = 0; i < r.Size(); i++)
+    {
+        EXPECT_TRUE(std::isfinite(r.x[i]));
+        EXPECT_TRUE(std::isfinite(r.center[i]));
+        EXPECT_TRUE(std::isfinite(r.lower[i]));
+        EXPECT_TRUE(std::isfinite(r.upper[i]));
+    }
+}
+
+TEST(ReductionsTest, RollingWindowSkipsNonFinitePoints)
+{
+    Column x(vector<double>{0, 1, 2, 3, 4, 5, 6});
+    Column y(vector<double>{1, NaN, 3, Inf, 5, 7, -Inf});
+    ReducedSeries r;
+    RollingWindow(x, y, 2, r);
+
+    // Windows run over the kept points 1, 3, 5, 7
+    ASSERT_EQ(r.Size(), 4u);
+    ExpectAllFinite(r);
+    EXPECT_DOUBLE_EQ(r.x[1], 2.0);
+    EXPECT_DOUBLE_EQ(r.center[1], 2.0);
+    EXPECT_DOUBLE_EQ(r.center[3], 6.0);
+    EXPECT_DOUBLE_EQ(r.lower[3], 5.0);
+    EXPECT_DOUBLE_EQ(r.upper[3], 7.0);
+}
+
+TEST(ReductionsTest, BinnedReductionsSkipNonFinitePoints)
+{
+    Column x(vector<double>{NaN, 0, 1, Inf, 2, 3, -Inf});
+    Column y(vector<double>{9, 1, 2, 9, NaN, 4, 9});
+    ReducedSeries r;
+
+    // Bins span the finite x range 0..3; only (0, 1), (1, 2) and (3, 4) are kept
+    Envelope(x, y, 3, r);
+    ExpectAllFinite(r);
+    ASSERT_EQ(r.Size(), 3u);
+    EXPECT_DOUBLE_EQ(r.x[0], 0.5);
+    EXPECT_DOUBLE_EQ(r.lower[0], 1.0);
+    EXPECT_DOUBLE_EQ(r.upper[2], 4.0);
+
+    PercentileBand(x, y, 3, 0.1, 0.9, r);
+    ExpectAllFinite(r);
+    EXPECT_EQ(r.Size(), 3u);
+}
@@ -0,0 +1,127 @@
+#include "RenderCache.h"
+#include "Bitmap.h"
+#include "XYPlot.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+
+static vector<unsigned char> SmallImage()
+{
+    FrameBuffer frame;
+    frame.Resize(8, 4);
+    frame.Clear();
+    return frame.EncodeBMP();
+}
+
+// A line plot of a sine wave
+static void AddWave(XYPlot &plot)
+{
+    vector<double> x(500), y(500);
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        x[i] = static_cast<double>(i);
+        y[i] = sin(x[i] * 0.05);
+    }
+    plot.addLinePlot(x, y);
+}
+
+class RenderCacheTest : public ::testing::Test
+{
+protected:
+    string directory = ::testing::TempDir();
+
+    // File the disk tier keeps for key
+    string DiskPath(uint64_t key) const
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx.bmp", static_cast<unsigned long long>(key));
+        return directory + name;
+    }
+
+    void TearDown() override
+    {
+        for (uint64_t key : {0x1234ULL, 0x5678ULL})
+            std::remove(DiskPath(key).c_str());
+    }
+};
+
+TEST_F(RenderCacheTest, DiskTierSurvivesNewCache)
+{
+    vector<unsigned char> image = SmallImage();
+    RenderCache(1 << 20, directory).Store(0x1234, image);
+
+    RenderCache cache(1 << 20, directory);
+    vector<unsigned char> loaded;
+    ASSERT_TRUE(cache.Lookup(0x1234, loaded));
+    EXPECT_EQ(loaded, image);
+}
+
+TEST_F(RenderCacheTest, TruncatedFileIsAMiss)
+{
+    vector<unsigned char> image = SmallImage();
+    RenderCache(1 << 20, directory).Store(0x5678, image);
+
+    // Cut the stored file short, as a crash mid-write would have
+    {
+        ofstream file(DiskPath(0x5678), ios::binary | ios::trunc);
+        file.write(reinterpret_cast<const char *>(image.data()), image.size() / 2);
+    }
+
+    RenderCache cache(1 << 20, directory);
+    vector<unsigned char> loaded;
+    EXPECT_FALSE(cache.Lookup(0x5678, loaded));
+    EXPECT_EQ(cache.Misses(), 1u);
+}
+
+TEST_F(RenderCacheTest, SecondRenderIsACacheHit)
+{
+    XYPlot plot;
+    AddWave(plot);
+    RenderCache cache;
+    plot.SetRenderCache(&cache);
+
+    vector<unsigned char> first = plot.RenderImage();
+    vector<unsigned char> second = plot.RenderImage();
+    EXPECT_EQ(cache.Misses(), 1u);
+    EXPECT_EQ(cache.Hits(), 1u);
+    EXPECT_FALSE(first.empty());
+    EXPECT_EQ(first, second);
+}
+
+TEST_F(RenderCacheTest, ChangesProduceNewKeys)
+{
+    XYPlot plot;
+    AddWave(plot);
+    uint64_t initial = plot.RenderKey();
+    EXPECT_EQ(plot.RenderKey(), initial);
+
+    plot.SetViewLimits({0.0, 100.0, -1.0, 1.0});
+    uint64_t zoomed = plot.RenderKey();
+    EXPECT_NE(zoomed, initial);
+
+    vector<double> flat(500, 0.25);
+    plot.updateColumn(plot.Series(0).y_column, Column(flat));
+    uint64_t updated = plot.RenderKey();
+    EXPECT_NE(updated, zoomed);
+    EXPECT_NE(updated, initial);
+
+    plot.SetPalette(Palette(PaletteKind::OkabeIto));
+    uint64_t recolored = plot.RenderKey();
+    EXPECT_NE(recolored, updated);
+    EXPECT_NE(recolored, zoomed);
+    EXPECT_NE(recolored, initial);
+}
+
+TEST_F(RenderCacheTest, ChangedPlotMissesTheCache)
+{
+    XYPlot plot;
+    AddWave(plot);
+    RenderCache cache;
+    plot.SetRenderCache(&cache);
+
+    vector<unsigned char> before = plot.RenderImage();
+    plot.SetPalette(Palette(PaletteKind::OkabeIto));
+    vector<unsigned char> after = plot.RenderImage();
+    EXPECT_EQ(cache.Misses(), 2u);
+    EXPECT_EQ(cache.Hits(), 0u);
+    EXPECT_NE(before, after);
+}
@@ -0,0 +1,64 @@
+#include "XYPlot.h"
+#include <gtest/gtest.h>
+
+static void AddWave(XYPlot &plot)
+{
+    vector<double> x(1000), y(1000);
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        x[i] = static_cast<double>(i);
+        y[i] = sin(x[i] * 0.05);
+    }
+    plot.addLinePlot(x, y);
+}
+
+#ifdef CPPPLOT_PROFILE
+// Each read moves the totals on by one 64-byte allocation, so a render that
+// reads them at its start and end sees exactly one
+static HeapTotals fake_totals;
+static HeapTotals AdvancingTotals()
+{
+    fake_totals.allocations += 1;
+    fake_totals.bytes += 64;
+    return fake_totals;
+}
+
+TEST(RenderStatsTest, AllocationsComeFromTheHeapCounter)
+{
+    XYPlot plot;
+    AddWave(plot);
+    SetHeapCounter(AdvancingTotals);
+    RenderStats stats;
+    plot.RenderImage(&stats);
+    SetHeapCounter(nullptr);
+
+    EXPECT_EQ(stats.allocations, 1u);
+    EXPECT_EQ(stats.bytes_allocated, 64u);
+    EXPECT_EQ(stats.points_ingested, 1000u);
+    EXPECT_FALSE(stats.stages.empty());
+    EXPECT_NE(stats.ToChromeTrace().find("\"allocations\":1,\"bytes_allocated\":64"), string::npos);
+}
+
+TEST(RenderStatsTest, NoHeapCounterReportsNoAllocations)
+{
+    XYPlot plot;
+    AddWave(plot);
+    RenderStats stats;
+    plot.RenderImage(&stats);
+    EXPECT_EQ(stats.allocations, 0u);
+    EXPECT_EQ(stats.bytes_allocated, 0u);
+}
+#else
+TEST(RenderStatsTest, UnprofiledRenderReportsZeroes)
+{
+    XYPlot plot;
+    AddWave(plot);
+    RenderStats stats;
+    stats.points_ingested = 7;
+    stats.allocations = 7;
+    plot.RenderImage(&stats);
+    EXPECT_EQ(stats.points_ingested, 0u);
+    EXPECT_EQ(stats.allocations, 0u);
+    EXPECT_TRUE(stats.stages.empty());
+}
+#endif
@@ -0,0 +1,105 @@
+#include "XYPlot.h"
+#include <gtest/gtest.h>
+
+TEST(SeriesStoreTest, ColumnsKeepTheirDtype)
+{
+    Column doubles(vector<double>{1.5, -2.0, 4.0});
+    EXPECT_EQ(doubles.Type(), DType::Float64);
+    EXPECT_EQ(doubles.Bytes(), 3 * sizeof(double));
+    EXPECT_DOUBLE_EQ(doubles.Min(), -2.0);
+    EXPECT_DOUBLE_EQ(doubles.Max(), 4.0);
+    EXPECT_DOUBLE_EQ(doubles.ValueAt(0), 1.5);
+
+    Column floats(vector<float>{1.5f, -2.0f, 4.0f});
+    EXPECT_EQ(floats.Type(), DType::Float32);
+    EXPECT_EQ(floats.Bytes(), 3 * sizeof(float));
+    EXPECT_DOUBLE_EQ(floats.Min(), -2.0);
+    EXPECT_DOUBLE_EQ(floats.Max(), 4.0);
+    EXPECT_DOUBLE_EQ(floats.ValueAt(2), 4.0);
+
+    // Timestamps are stored as epoch nanoseconds and read as epoch seconds
+    Column times = Column::Timestamps({2000000000LL, 500000000LL, 3500000000LL});
+    EXPECT_EQ(times.Type(), DType::Int64Time);
+    EXPECT_EQ(times.Bytes(), 3 * sizeof(int64_t));
+    EXPECT_DOUBLE_EQ(times.Min(), 0.5);
+    EXPECT_DOUBLE_EQ(times.Max(), 3.5);
+    EXPECT_DOUBLE_EQ(times.ValueAt(0), 2.0);
+
+    // The hash covers the dtype as well as the values
+    EXPECT_EQ(doubles.Hash(), Column(vector<double>{1.5, -2.0, 4.0}).Hash());
+    EXPECT_NE(doubles.Hash(), floats.Hash());
+}
+
+TEST(SeriesStoreTest, ReplaceRecomputesMinMaxAndHash)
+{
+    SeriesStore store;
+    int index = store.Add(Column(vector<double>{1.0, 2.0, 3.0}));
+    uint64_t hash = store[index].Hash();
+
+    store.Replace(index, Column(vector<double>{1.0, 2.0, 30.0}));
+    EXPECT_DOUBLE_EQ(store[index].Max(), 30.0);
+    EXPECT_NE(store[index].Hash(), hash);
+}
+
+TEST(SeriesStoreTest, UpdateColumnRefreshesLimitsAndSeriesHash)
+{
+    XYPlot plot;
+    int x = plot.addColumn(vector<double>{0.0, 1.0, 2.0, 3.0});
+    int y = plot.addColumn(vector<double>{0.0, 1.0, 0.0, 1.0});
+    plot.addLineSeries(x, y);
+    uint64_t hash = plot.Series(0).data_hash;
+    AxisLimits before = plot.ComputeLimits();
+
+    plot.updateColumn(y, Column(vector<double>{0.0, 10.0, 0.0, 10.0}));
+    AxisLimits after = plot.ComputeLimits();
+    EXPECT_NE(plot.Series(0).data_hash, hash);
+    EXPECT_GT(after.y_upper, before.y_upper);
+    EXPECT_DOUBLE_EQ(after.x_upper, before.x_upper);
+}
+
+TEST(SeriesStoreTest, SeriesShareAnXColumn)
+{
+    XYPlot plot;
+    vector<double> time_base(100), a(100), b(100);
+    for (size_t i = 0; i < time_base.size(); i++)
+    {
+        time_base[i] = static_cast<double>(i);
+        a[i] = sin(i * 0.1);
+        b[i] = cos(i * 0.1);
+    }
+    int x = plot.addColumn(time_base);
+    plot.addLineSeries(x, plot.addColumn(a));
+    plot.addLineSeries(x, plot.addColumn(b));
+
+    // One copy of the time base for both series
+    EXPECT_EQ(plot.Store().Size(), 3u);
+    EXPECT_EQ(plot.Store().Bytes(), 3 * 100 * sizeof(double));
+    EXPECT_EQ(plot.Series(0).x_column, plot.Series(1).x_column);
+
+    // Both series read the shared column, so both are rehashed when it changes
+    uint64_t first = plot.Series(0).data_hash, second = plot.Series(1).data_hash;
+    vector<double> shifted(time_base);
+    for (double &t : shifted)
+        t += 1000.0;
+    plot.updateColumn(x, Column(shifted));
+    EXPECT_NE(plot.Series(0).data_hash, first);
+    EXPECT_NE(plot.Series(1).data_hash, second);
+}
+
+TEST(SeriesStoreTest, TimeAxisLabels)
+{
+    XYPlot plot;
+    plot.addLineSeries(plot.addTimeColumn({0, 1000000000LL}), plot.addColumn(vector<double>{0.0, 1.0}));
+    EXPECT_TRUE(plot.TimeAxis());
+
+    // Dates once the axis spans two days or more, times of day below that
+    const double day = 86400.0;
+    EXPECT_EQ(plot.TimeToString(0.0, 60.0), "00:00:00");
+    EXPECT_EQ(plot.TimeToString(3661.0, 60.0), "01:01:01");
+    EXPECT_EQ(plot.TimeToString(0.0, 2 * day), "1970-01-01");
+    EXPECT_EQ(plot.TimeToString(951782400.0, 30 * day), "2000-02-29");
+    EXPECT_EQ(plot.TimeToString(951782400.0 + 45296.0, 60.0), "12:34:56");
+    // Before the epoch
+    EXPECT_EQ(plot.TimeToString(-1.0, 30 * day), "1969-12-31");
+    EXPECT_EQ(plot.TimeToString(-1.0, 60.0), "23:59:59");
+}